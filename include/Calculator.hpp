@@ -35,6 +35,11 @@ SOFTWARE.
 #include <Windows.h>
 #include <wchar.h>
 #include <locale>
+#include <fstream>
+#include <chrono>
+#include <memory>
+#include "calc_input.hpp"
+#include "history_log.hpp"
 
 struct Vector2i
 {
@@ -58,43 +63,29 @@ public:
     void UpdateInputbox(HWND hWnd);
 
 private:
-    const std::vector<std::vector<std::wstring>> buttonsText = {
-        {L"\uE94D", L"CE", L"C", L"\uE94F"},
-        {L"7",      L"8",  L"9", L"\uE94A"},
-        {L"4",      L"5",  L"6", L"\uE947"},
-        {L"1",      L"2",  L"3", L"\uE949"},
-        {L"\uE94E", L"0",  L".", L"\uE948"}
-    };
+    const std::vector<std::vector<std::wstring>> buttonsText = button_grid();
     std::vector<HWND> buttons;
-    const std::unordered_map<wchar_t, wchar_t> UnicodeMap =
-    {
-        { L'\uE948', L'+' }, // Calculator Addition
-        { L'\uE949', L'-' }, // Calculator Subtract
-        { L'\uE947', L'*' }, // Calculator Multiply
-        { L'\uE94A', L'/' }, // Calculator Divide
-    };
 
     const int DEFAULT_SIZE = 32;
     const int BUTTON_SPACING = 10;
 
     HWND inputBox;
-    std::wstring input = L"0", prevInput, answer;
+    calc_input core;
+
+    // Set W32CALC_RECORD to a file path to record the session for replay
+    std::ofstream session;
+    std::chrono::steady_clock::time_point sessionStart;
+
+    // Kept in W32CALC_HISTORY, or W32Calc.history under %LOCALAPPDATA%
+    std::unique_ptr<history_log> history;
 
     HFONT GENERATE_FONT(int FontSize);
     Vector2i BOARD_POS(int height);
 
-    // Helper function
-    bool Filter(const std::vector<std::wstring>& filter, const wchar_t* target);
-    std::wstring TranslateUnicode(std::wstring wstr);
-    void InputParser(std::wstring input, double& num1, double& num2, wchar_t& op);
-    double CalculateInput(std::wstring input);
-    void NegateNumber(std::wstring& input);
-    void EraseFinalNumber(std::wstring& input);
+    void Dispatch(input_source source, uint32_t code);
 
     // Converter function
-    std::string wstr2str(std::wstring wstr);
     std::wstring str2wstr(std::string str);
-    std::wstring double2wstr(double number);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef BATCH_F32_HPP
+#define BATCH_F32_HPP
+
+#include "program.hpp"
+
+// Single precision version of run_batch for callers that only need about
+// seven significant digits. float lanes are twice as many per vector as
+// double lanes.
+//
+// Every stack slot carries, next to its value, a running bound on the
+// absolute error accumulated so far: one float rounding per operation plus
+// the propagated input errors. Each product and quotient also adds 2^-100
+// to cover underflow, so results that are zero or smaller than about
+// 2^-100 / tolerance are always recomputed. A comparison, logical operator
+// or conditional whose outcome the bound cannot settle makes the bound
+// infinite. Rows whose final bound exceeds tolerance * |result|, or whose
+// result overflowed float, are recomputed in double with run_batch() and
+// rounded back to float.
+//
+// Returns the number of rows that were recomputed.
+size_t run_batch_f32(const program_view& p, const float* const* columns, float* out, size_t rows, float tolerance);
+
+#endif
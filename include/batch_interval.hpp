@@ -0,0 +1,48 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef BATCH_INTERVAL_HPP
+#define BATCH_INTERVAL_HPP
+
+#include "program.hpp"
+
+// Interval version of run_batch: every row's result is an interval
+// [out_lo[i], out_hi[i]] guaranteed to contain the exact value of the
+// expression for any inputs inside [lo_columns[j][i], hi_columns[j][i]].
+// Pass the same column for both bounds to evaluate points. Literals that
+// are not exact in double get a one-ulp wide interval.
+//
+// The FPU is switched to upward rounding once per call, not once per
+// operation. Lower bounds are stored negated so that rounding -lo up
+// rounds lo down, and every operation is a straight-line kernel over
+// split arrays of negated lower and upper bounds.
+//
+// Division by an interval containing zero gives [-inf, inf], a bound that
+// comes out NaN becomes infinite. Comparisons and logical operators give [0, 1]
+// when the intervals do not decide them. Flattened sums and products are
+// folded as plain interval operations.
+void run_batch_interval(const program_view& p, const double* const* lo_columns, const double* const* hi_columns,
+                        double* out_lo, double* out_hi, size_t rows);
+
+#endif
@@ -0,0 +1,89 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef BIG_INT_HPP
+#define BIG_INT_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Signed arbitrary-precision integer, magnitude stored as little-endian
+// base 2^32 limbs. Zero has no limbs and is never negative.
+class big_int
+{
+public:
+    big_int() : negative(false) {}
+    big_int(int64_t value);
+
+    static big_int from_string(const std::string& digits);
+    std::string to_string() const;
+
+    bool is_zero() const { return limbs.empty(); }
+    bool is_negative() const { return negative; }
+    size_t limb_count() const { return limbs.size(); }
+    bool fits_int64() const;
+    int64_t to_int64() const;
+
+    big_int operator-() const;
+    big_int& operator+=(const big_int& rhs);
+    big_int& operator-=(const big_int& rhs);
+    big_int& operator*=(const big_int& rhs);
+    big_int& operator/=(const big_int& rhs);
+    big_int& operator%=(const big_int& rhs);
+
+    // Truncating division (C semantics), throws on division by zero
+    static void divmod(const big_int& a, const big_int& b, big_int& quot, big_int& rem);
+    static int compare(const big_int& a, const big_int& b);
+    // Binary (Stein) GCD of the magnitudes, gcd(0, 0) is 0
+    static big_int gcd(const big_int& a, const big_int& b);
+
+private:
+    typedef std::vector<uint32_t> magnitude;
+
+    big_int(magnitude mag, bool neg);
+    void trim();
+
+    static magnitude multiply(const magnitude& a, const magnitude& b);
+    static magnitude multiply_karatsuba(const magnitude& a, const magnitude& b);
+    static magnitude multiply_toom3(const magnitude& a, const magnitude& b);
+
+    magnitude limbs;
+    bool negative;
+};
+
+inline big_int operator+(big_int a, const big_int& b) { return a += b; }
+inline big_int operator-(big_int a, const big_int& b) { return a -= b; }
+inline big_int operator*(big_int a, const big_int& b) { return a *= b; }
+inline big_int operator/(big_int a, const big_int& b) { return a /= b; }
+inline big_int operator%(big_int a, const big_int& b) { return a %= b; }
+
+inline bool operator==(const big_int& a, const big_int& b) { return big_int::compare(a, b) == 0; }
+inline bool operator!=(const big_int& a, const big_int& b) { return big_int::compare(a, b) != 0; }
+inline bool operator<(const big_int& a, const big_int& b) { return big_int::compare(a, b) < 0; }
+inline bool operator>(const big_int& a, const big_int& b) { return big_int::compare(a, b) > 0; }
+inline bool operator<=(const big_int& a, const big_int& b) { return big_int::compare(a, b) <= 0; }
+inline bool operator>=(const big_int& a, const big_int& b) { return big_int::compare(a, b) >= 0; }
+
+#endif
@@ -0,0 +1,105 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CALC_INPUT_HPP
+#define CALC_INPUT_HPP
+
+#include "tiered_eval.hpp"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+class history_log;
+
+// Character codes the keyboard path reacts to besides "0-9+-*/", same
+// values as VK_BACK and VK_RETURN
+const uint32_t KEY_BACK = 0x08;
+const uint32_t KEY_RETURN = 0x0D;
+
+const size_t BUTTON_ROWS = 5;
+const size_t BUTTON_COLUMNS = 4;
+// Button captions, the private use characters are Segoe MDL2 Assets glyphs
+extern const wchar_t* const BUTTON_LABELS[BUTTON_ROWS][BUTTON_COLUMNS];
+
+enum class input_source : uint32_t
+{
+    key,    // code is the WM_CHAR character
+    button  // code is row * BUTTON_COLUMNS + column
+};
+
+struct input_event
+{
+    input_source source;
+    uint32_t code;
+    uint64_t time_us; // Since the start of the session, only used by recordings
+};
+
+// Editing and evaluation state behind the calculator window, without any
+// Win32 dependency, so sessions can be replayed headlessly.
+class calc_input
+{
+public:
+    calc_input() : input(L"0"), history(nullptr) {}
+
+    // Completed calculations are appended here, null to keep no history
+    void set_history(history_log* log) { history = log; }
+
+    void handle(const input_event& ev);
+    void press_key(uint32_t code);
+    void press_button(size_t index);
+
+    // Text for the display, false when it has not changed since the last call
+    bool refresh(std::wstring& display);
+    const std::wstring& text() const { return input; }
+    // Call counts and promotions of the expressions '=' evaluated
+    const tiered_evaluator& evaluations() const { return evaluator; }
+    // Message of the last input that failed to parse or evaluate, cleared
+    // once taken
+    bool take_error(std::string& message);
+
+private:
+    void parse_input(const std::wstring& input, double& num1, double& num2, wchar_t& op);
+    double calculate_input(const std::wstring& input);
+    void negate_number(std::wstring& input);
+    void erase_final_number(std::wstring& input);
+    void record(const std::wstring& expression, const std::wstring& result);
+
+    std::wstring input, prev_input, answer;
+    std::string error;
+    history_log* history;
+    tiered_evaluator evaluator;
+};
+
+// Whether the event runs the evaluator rather than just editing the text
+bool evaluates(const input_event& ev);
+std::vector<std::vector<std::wstring>> button_grid();
+std::wstring double2wstr(double number);
+
+// Session recordings hold one "key|button <code> <time_us>" line per event
+void write_event(std::ostream& out, const input_event& ev);
+// Throws on malformed lines
+std::vector<input_event> read_session(std::istream& in);
+
+#endif
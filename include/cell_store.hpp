@@ -0,0 +1,75 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef CELL_STORE_HPP
+#define CELL_STORE_HPP
+
+#include "expr_eval.hpp"
+#include <unordered_map>
+
+// Named formulas that may reference each other ("total = a + b").
+// Changing a cell only marks it and its transitive dependents dirty; the
+// next read recomputes just those cells in dependency order, evaluating
+// cells of the same topological level concurrently.
+// A reference to a cell that was never set, or to a cell whose formula
+// failed, makes the referencing cell fail as well.
+class cell_store
+{
+public:
+    explicit cell_store(unsigned threads = 0);
+
+    // Throws on syntax errors and circular references, the store is left
+    // unchanged in both cases
+    void set(const std::string& name, const std::string& formula);
+    double get(const std::string& name);
+    bool contains(const std::string& name) const;
+
+    // Recompute every dirty cell, returns how many were evaluated
+    size_t recompute();
+
+private:
+    struct cell
+    {
+        std::string name;
+        std::string formula;
+        std::vector<token> program;
+        std::vector<size_t> refs;       // Cell read by each variable token, in order
+        std::vector<size_t> dependents; // Cells whose formula references this one
+        double value;
+        std::string error;
+        bool defined;
+        bool dirty;
+    };
+
+    size_t find_or_add(const std::string& name);
+    bool reaches(size_t from, size_t target) const;
+    void mark_dirty(size_t id);
+    void compute(size_t id);
+
+    std::vector<cell> cells;
+    std::unordered_map<std::string, size_t> index;
+    unsigned threads;
+};
+
+#endif
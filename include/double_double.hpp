@@ -0,0 +1,146 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef DOUBLE_DOUBLE_HPP
+#define DOUBLE_DOUBLE_HPP
+
+#include <cmath>
+#include <string>
+
+// Unevaluated sum hi + lo of two doubles with |lo| <= ulp(hi) / 2, about
+// 106 bits of significand. Built from error-free transformations, TwoProd
+// uses a fused multiply-add where the target has one in hardware.
+struct double_double
+{
+    double hi, lo;
+
+    double_double() : hi(0.0), lo(0.0) {}
+    double_double(double value) : hi(value), lo(0.0) {}
+    double_double(double h, double l) : hi(h), lo(l) {}
+
+    // Decimal literal read to double-double accuracy, "0.1" keeps its tail
+    static double_double from_literal(const std::string& text);
+    // Up to 32 significant digits
+    std::string to_string() const;
+
+    double_double operator-() const { return double_double(-hi, -lo); }
+    double_double& operator+=(const double_double& rhs);
+    double_double& operator-=(const double_double& rhs);
+    double_double& operator*=(const double_double& rhs);
+    double_double& operator/=(const double_double& rhs);
+};
+
+#if defined(__FMA__) || defined(__AVX2__) || defined(__aarch64__) || defined(_M_ARM64)
+#define DD_HAS_FMA 1
+#endif
+
+// a + b = s + e exactly
+inline double_double two_sum(double a, double b)
+{
+    double s = a + b;
+    double bb = s - a;
+    return double_double(s, (a - (s - bb)) + (b - bb));
+}
+
+// Same, requires |a| >= |b|
+inline double_double fast_two_sum(double a, double b)
+{
+    double s = a + b;
+    return double_double(s, b - (s - a));
+}
+
+// a * b = p + e exactly
+inline double_double two_prod(double a, double b)
+{
+    double p = a * b;
+#if defined(DD_HAS_FMA)
+    return double_double(p, std::fma(a, b, -p));
+#else
+    // Dekker's product with Veltkamp splitting. split * a overflows above
+    // 2^996, such an operand is split scaled down by 2^53 and the
+    // pieces scaled back, which is exact
+    const double split = 134217729.0; // 2^27 + 1
+    const double big = 6.696928794914171e+299, scale = 9007199254740992.0; // 2^996, 2^53
+    if((std::fabs(a) > big && std::isfinite(a)) || (std::fabs(b) > big && std::isfinite(b)))
+    {
+        double_double r = std::fabs(a) > big && std::isfinite(a) ? two_prod(a / scale, b) : two_prod(a, b / scale);
+        return double_double(r.hi * scale, r.lo * scale);
+    }
+    double ta = split * a, tb = split * b;
+    double ah = ta - (ta - a), al = a - ah;
+    double bh = tb - (tb - b), bl = b - bh;
+    return double_double(p, ((ah * bh - p) + ah * bl + al * bh) + al * bl);
+#endif
+}
+
+// Infinities and NaNs would turn the error term into NaN, keep them as is
+inline double_double dd_add(const double_double& a, const double_double& b)
+{
+    double_double s = two_sum(a.hi, b.hi);
+    double_double t = two_sum(a.lo, b.lo);
+    s.lo += t.hi;
+    s = fast_two_sum(s.hi, s.lo);
+    s.lo += t.lo;
+    s = fast_two_sum(s.hi, s.lo);
+    double plain = a.hi + b.hi;
+    return std::isfinite(plain) ? s : double_double(plain);
+}
+
+inline double_double dd_mul(const double_double& a, const double_double& b)
+{
+    double_double p = two_prod(a.hi, b.hi);
+    p.lo += a.hi * b.lo + a.lo * b.hi;
+    p = fast_two_sum(p.hi, p.lo);
+    double plain = a.hi * b.hi;
+    return std::isfinite(plain) ? p : double_double(plain);
+}
+
+inline double_double dd_div(const double_double& a, const double_double& b)
+{
+    double q1 = a.hi / b.hi;
+    if(!std::isfinite(q1) || q1 == 0.0)
+        return double_double(q1);
+    double_double r = dd_add(a, -dd_mul(b, double_double(q1)));
+    double q2 = r.hi / b.hi;
+    r = dd_add(r, -dd_mul(b, double_double(q2)));
+    double q3 = r.hi / b.hi;
+    return dd_add(fast_two_sum(q1, q2), double_double(q3));
+}
+
+inline bool dd_less(const double_double& a, const double_double& b)
+{
+    return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+inline bool dd_equal(const double_double& a, const double_double& b)
+{
+    return a.hi == b.hi && a.lo == b.lo;
+}
+
+inline double_double& double_double::operator+=(const double_double& rhs) { return *this = dd_add(*this, rhs); }
+inline double_double& double_double::operator-=(const double_double& rhs) { return *this = dd_add(*this, -rhs); }
+inline double_double& double_double::operator*=(const double_double& rhs) { return *this = dd_mul(*this, rhs); }
+inline double_double& double_double::operator/=(const double_double& rhs) { return *this = dd_div(*this, rhs); }
+
+#endif
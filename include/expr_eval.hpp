@@ -28,10 +28,14 @@ SOFTWARE.
 #include <string>
 #include <stdexcept>
 #include <vector>
+#include "big_int.hpp"
+#include "double_double.hpp"
+#include "rational.hpp"
 
 enum class token_type
 {
  number,
+ variable,
  plus,
  minus,
  // Custom handling start //
@@ -40,8 +44,24 @@ enum class token_type
  // Custom handling end //
  multiply,
  divide,
+ less,
+ less_equal,
+ greater,
+ greater_equal,
+ equal,
+ not_equal,
+ logical_and,
+ logical_or,
+ logical_not,
+ question,
+ colon,
+ conditional, // "c ? a : b" in postfix, pops c, a and b
  lparen,
  rparen,
+ // Vector and matrix literals, only matrix expressions accept these
+ lbracket,
+ rbracket,
+ comma,
  end
 };
 
@@ -49,6 +69,17 @@ struct token
 {
  token_type type;
  double number;
+ // Source span of number literals and variable names, empty for the rest
+ size_t begin = 0;
+ size_t length = 0;
+};
+
+enum class eval_mode
+{
+ floating,
+ integer,
+ rational,
+ double_double
 };
 
 class token_parser
@@ -61,7 +92,9 @@ public:
 
 private:
  void skip_space();
+ bool match(char c);
  token get_number();
+ token get_identifier();
 
  std::string expr;
  uint64_t pos;
@@ -69,5 +102,19 @@ private:
 
 std::vector<token> infix_to_postfix(std::string infix);
 double evaluate(std::vector<token> tks);
+// Variables are bound by position: the n-th variable token reads variables[n]
+double evaluate(const std::vector<token>& tks, const std::vector<double>& variables);
+// Exact evaluation, literals are re-read from the source the tokens came from
+big_int evaluate_integer(const std::vector<token>& tks, const std::string& infix);
+// Result is reduced to lowest terms
+rational evaluate_rational(const std::vector<token>& tks, const std::string& infix);
+// About 106-bit precision, rounding behaves like double otherwise
+double_double evaluate_double_double(const std::vector<token>& tks, const std::string& infix);
+std::string evaluate(const std::string& infix, eval_mode mode);
+// Same value as evaluate(infix_to_postfix(infix)), computed while parsing
+// with no token buffer, for expressions evaluated once. Also rejects
+// leftover operands ("2 3") that the postfix path ignores.
+double evaluate_direct(const std::string& infix);
+std::string format_result(double value);
 
 #endif
@@ -0,0 +1,43 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef GRADIENT_HPP
+#define GRADIENT_HPP
+
+#include "program.hpp"
+
+// Forward-mode automatic differentiation over a compiled program. Every
+// stack slot carries the value and one tangent per requested variable
+// (dual numbers), each stored as its own lane array, so value and all
+// partial derivatives come out of a single pass over the rows.
+//
+// wrt lists the variable slots to differentiate by. values receives one
+// result per row, gradients[j] receives d(result)/d(variable wrt[j]) per
+// row. Comparisons and logical operators are piecewise constant and have
+// zero derivative; a conditional takes the derivative of the chosen side.
+void run_batch_gradient(const program_view& p, const double* const* columns,
+                        const uint32_t* wrt, size_t wrt_count,
+                        double* values, double* const* gradients, size_t rows);
+
+#endif
@@ -0,0 +1,77 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef HISTORY_LOG_HPP
+#define HISTORY_LOG_HPP
+
+#include "mapped_file.hpp"
+#include <cstdint>
+#include <vector>
+
+// Two memory mapped files, both only ever appended to:
+//   <path>      expression and result bytes, back to back
+//   <path>.idx  header (magic "W32CHIS", version, record count, bytes used
+//               in the log), then one fixed-size entry per record: log
+//               offset, lengths, time and the first 8 expression bytes
+// and an empty <path>.lock that the open history holds a file lock on.
+// Files grow geometrically, so an append is amortized O(1), and opening
+// maps them without reading any records.
+const uint32_t HISTORY_VERSION = 1;
+
+struct history_record
+{
+    std::string expression;
+    std::string result;
+    uint64_t time; // Seconds since the epoch
+};
+
+// Persistent calculation history. Only one history_log can have a path
+// open at a time, the constructor throws while another process holds it.
+// Records are written before the count that publishes them, so a crash
+// loses at most the record being appended.
+class history_log
+{
+public:
+    explicit history_log(const std::string& path);
+
+    size_t size() const;
+    void append(const std::string& expression, const std::string& result, uint64_t time);
+    history_record get(size_t i) const;
+    // Records whose expression starts with prefix, newest first, at most
+    // limit of them. The scan compares the index keys and only reads the
+    // log for prefixes longer than a key.
+    std::vector<size_t> search_prefix(const std::string& prefix, size_t limit) const;
+    // Push appended records to disk
+    void flush();
+
+private:
+    void reserve(size_t entries, uint64_t bytes);
+
+    std::string path;
+    file_lock lock; // Taken before the files are mapped
+    mapped_file index;
+    mapped_file log;
+};
+
+#endif
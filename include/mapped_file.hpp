@@ -0,0 +1,84 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+// Memory mapping of a whole file, read-only unless opened writable. The
+// mapping is shared, so several processes opening the same file share its
+// pages and writes land in the file.
+class mapped_file
+{
+public:
+    mapped_file() : base(nullptr), length(0), handle(nullptr), writable(false) {}
+    explicit mapped_file(const std::string& path);
+    // Read-write mapping, the file is created if missing and grown to at
+    // least min_size bytes (new bytes read as zero)
+    static mapped_file open_writable(const std::string& path, size_t min_size);
+    ~mapped_file();
+
+    mapped_file(mapped_file&& other);
+    mapped_file& operator=(mapped_file&& other);
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    const unsigned char* data() const { return base; }
+    // Null unless the mapping is writable
+    unsigned char* writable_data() { return writable ? const_cast<unsigned char*>(base) : nullptr; }
+    size_t size() const { return length; }
+    // Write dirty pages back to the file
+    void flush();
+    void close();
+
+private:
+    const unsigned char* base;
+    size_t length;
+    void* handle; // Mapping object handle on Windows, unused elsewhere
+    bool writable;
+};
+
+// Exclusive lock on a file, held for the lifetime of the object. The file
+// is created if missing. Throws if another process, or another file_lock
+// in this one, holds it.
+class file_lock
+{
+public:
+    explicit file_lock(const std::string& path);
+    ~file_lock();
+
+    file_lock(const file_lock&) = delete;
+    file_lock& operator=(const file_lock&) = delete;
+
+private:
+#if defined(_WIN32)
+    void* handle;
+#else
+    int fd;
+#endif
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef MATRIX_EXPR_HPP
+#define MATRIX_EXPR_HPP
+
+#include "expr_eval.hpp"
+#include <cstdint>
+
+// Tiles of this many rows, columns and inner products per matrix multiply
+const size_t MATMUL_BLOCK = 64;
+
+enum class value_kind
+{
+    scalar,
+    vector,
+    matrix
+};
+
+// Vectors have rows = length and cols = 1, scalars are 1 x 1. Values are
+// stored row-major.
+struct value_shape
+{
+    value_kind kind;
+    uint32_t rows;
+    uint32_t cols;
+
+    static value_shape scalar() { return { value_kind::scalar, 1, 1 }; }
+    static value_shape vector(uint32_t length) { return { value_kind::vector, length, 1 }; }
+    static value_shape matrix(uint32_t rows, uint32_t cols) { return { value_kind::matrix, rows, cols }; }
+
+    size_t size() const { return (size_t)rows * cols; }
+    std::string to_string() const;
+};
+
+struct matrix_variable
+{
+    std::string name;
+    value_shape shape;
+};
+
+// Expression over scalars, vectors and dense matrices, e.g. "A*x + b".
+//
+// Literals: [1, 2, 3] is a vector, [[1, 2], [3, 4]] a matrix given by its
+// rows; elements may be any expression of the right shape. Operators:
+//   + -    same shapes, or a scalar and anything (broadcast)
+//   *      scalar scaling, matrix * matrix, matrix * vector, vector * matrix
+//   /      anything divided by a scalar
+//   unary + -
+// Shapes are checked by compile(), which throws on a mismatch. Every
+// intermediate gets a buffer in one arena sized at compile time, so run()
+// never allocates.
+class matrix_program
+{
+public:
+    static matrix_program compile(const std::string& infix, const std::vector<matrix_variable>& variables);
+
+    const value_shape& result_shape() const { return shape; }
+    // variables[i] points at the values of the i-th declared variable, out
+    // receives result_shape().size() values. Uses the program's arena, so
+    // one program must not run on two threads at once.
+    void run(const double* const* variables, double* out);
+
+    enum class step_op : uint32_t
+    {
+        add,
+        sub,
+        mul,
+        div,
+        neg,
+        matmul,
+        matvec,
+        vecmat,
+        gather
+    };
+
+    // A value is either a declared variable or a range of the arena
+    struct operand
+    {
+        bool variable;
+        uint32_t index; // Variable slot or arena offset
+        value_shape shape;
+    };
+
+    struct step
+    {
+        step_op op;
+        operand out, a, b;
+        uint32_t first, count; // Gathered operands, for gather
+    };
+
+private:
+    value_shape shape;
+    operand result;
+    std::vector<step> steps;
+    std::vector<operand> gathered;
+    std::vector<double> arena;
+};
+
+#endif
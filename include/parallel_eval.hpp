@@ -0,0 +1,42 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef PARALLEL_EVAL_HPP
+#define PARALLEL_EVAL_HPP
+
+#include "expr_eval.hpp"
+
+// Expressions shorter than this are handed straight to the sequential engine
+const size_t PARALLEL_MIN_LENGTH = 1 << 16;
+
+// Evaluate one very large expression on several threads (0 = one per core).
+// The expression is split at its top-level lowest-precedence operators, the
+// operands are parsed and evaluated concurrently and then combined. Results
+// are identical to evaluate(): double and double-double operands are folded
+// left to right in source order, the exact modes combine in a tree where
+// that is associative.
+double evaluate_parallel(const std::string& infix, unsigned threads = 0);
+std::string evaluate_parallel(const std::string& infix, eval_mode mode, unsigned threads = 0);
+
+#endif
@@ -0,0 +1,81 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef PARALLEL_FOR_HPP
+#define PARALLEL_FOR_HPP
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Run fn(i) for i in [0, count), contiguous index ranges per thread.
+// The first exception thrown by any worker is rethrown on the caller.
+template<typename F>
+inline void parallel_for(size_t count, unsigned threads, F fn)
+{
+    size_t workers = std::min<size_t>(threads, count);
+    if(workers <= 1)
+    {
+        for(size_t i = 0; i < count; i++)
+            fn(i);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    std::vector<std::exception_ptr> errors(workers);
+    for(size_t w = 0; w < workers; w++)
+    {
+        pool.emplace_back([&, w]()
+        {
+            try
+            {
+                size_t begin = count * w / workers, end = count * (w + 1) / workers;
+                for(size_t i = begin; i < end; i++)
+                    fn(i);
+            }
+            catch(...)
+            {
+                errors[w] = std::current_exception();
+            }
+        });
+    }
+    for(size_t w = 0; w < workers; w++)
+        pool[w].join();
+    for(size_t w = 0; w < workers; w++)
+    {
+        if(errors[w])
+            std::rethrow_exception(errors[w]);
+    }
+}
+
+// 0 means one thread per core
+inline unsigned resolve_threads(unsigned threads)
+{
+    if(threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    return threads;
+}
+
+#endif
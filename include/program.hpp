@@ -0,0 +1,131 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef PROGRAM_HPP
+#define PROGRAM_HPP
+
+#include "expr_eval.hpp"
+#include <cstdint>
+
+enum class opcode : uint32_t
+{
+    push_const, // operand: constant pool index
+    load_var,   // operand: variable slot
+    add,
+    sub,
+    mul,
+    div,
+    neg,
+    lt,
+    le,
+    gt,
+    ge,
+    eq,
+    ne,
+    land,
+    lor,
+    lnot,
+    select,     // pops c, a, b and pushes c != 0 ? a : b
+    // Flattened chains of '+' and '-' keep a running sum and its rounding
+    // error in two slots, each term is folded in with an error-free TwoSum
+    sum_begin,  // pushes a zero error slot above the first term
+    sum_add,    // pops a term into the sum below
+    sum_end,    // pops the error slot and adds it back into the sum
+    // Flattened chains of '*', same idea with TwoProd
+    prod_begin,
+    prod_mul,
+    prod_end
+};
+
+// Fixed 8 byte layout, stored as-is in program libraries
+struct instruction
+{
+    opcode op;
+    uint32_t operand;
+};
+
+// Non-owning view of a compiled expression. Points either into a program
+// or straight into a mapped program library.
+struct program_view
+{
+    const instruction* code;
+    const double* constants;
+    const double* constants_lo; // Rounding error of each constant's literal, -0.0 if it underflowed
+    const char* variable_names; // NUL separated, in slot order
+    uint32_t code_size;
+    uint32_t constant_count;
+    uint32_t variable_count;
+    uint32_t max_stack;
+    uint64_t source_hash;
+};
+
+// Chains of at least this many '+'/'-' or '*' terms are compiled to a
+// compensated n-ary reduction instead of a ladder of binary operators
+const size_t FLATTEN_MIN_TERMS = 8;
+
+// Compiled postfix form of one expression: a flat instruction stream, a
+// constant pool and one slot per distinct variable name. Long sums and
+// products are flattened (a - b + c becomes a + (-b) + c) and reduced with
+// error compensation, so their results are usually closer to exact than
+// evaluate()'s left fold and need not match it bit for bit.
+class program
+{
+public:
+    // flatten = false keeps every operator binary, so results match
+    // evaluate() bit for bit
+    static program compile(const std::string& infix, bool flatten = true);
+
+    program_view view() const;
+    const std::string& source() const { return src; }
+    const std::vector<std::string>& variables() const { return variable_names; }
+
+private:
+    std::string src;
+    std::vector<instruction> code;
+    std::vector<double> constants;
+    std::vector<double> constants_lo;
+    std::vector<std::string> variable_names;
+    std::string packed_names;
+    uint32_t max_stack;
+    uint64_t source_hash;
+};
+
+// FNV-1a, used to check a stored program against the formula it came from
+uint64_t hash_source(const std::string& source);
+// Slot of a variable name, false when the program does not use it
+bool find_variable(const program_view& p, const std::string& name, uint32_t& slot);
+// Check operands and stack discipline, throws if the program is malformed
+void verify(const program_view& p);
+// variables must hold p.variable_count values in slot order
+double run(const program_view& p, const double* variables);
+// Evaluate rows [0, rows) with one column per variable slot. Works through
+// the rows in fixed-size blocks, one tight loop per instruction, so the
+// kernels vectorize. Conditionals become masked selects, both branches are
+// computed for every row and no row takes a data-dependent branch.
+void run_batch(const program_view& p, const double* const* columns, double* out, size_t rows);
+// Same in double-double precision, row results are out_hi[i] + out_lo[i].
+// Constants keep the digits their literals lost when rounded to double.
+void run_batch_dd(const program_view& p, const double* const* columns, double* out_hi, double* out_lo, size_t rows);
+
+#endif
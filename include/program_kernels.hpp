@@ -0,0 +1,71 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef PROGRAM_KERNELS_HPP
+#define PROGRAM_KERNELS_HPP
+
+// Per-lane steps shared by every evaluator of compiled programs (run,
+// run_batch, run_batch_gradient), so their values cannot drift apart
+
+#include "double_double.hpp"
+#include <cstdint>
+#include <cstring>
+
+// All ones when c holds, so the select below is pure bit arithmetic
+inline double select_bits(double c, double a, double b)
+{
+    uint64_t mask = 0 - (uint64_t)(c != 0.0), x, y;
+    std::memcpy(&x, &a, sizeof(x));
+    std::memcpy(&y, &b, sizeof(y));
+    uint64_t r = (x & mask) | (y & ~mask);
+    double out;
+    std::memcpy(&out, &r, sizeof(out));
+    return out;
+}
+
+// One term of a flattened sum: TwoSum into the running value, the
+// rounding error collects in error
+inline void sum_step(double& sum, double& error, double term)
+{
+    double_double s = two_sum(sum, term);
+    sum = s.hi;
+    error += s.lo;
+}
+
+// One factor of a flattened product, same with TwoProd
+inline void prod_step(double& product, double& error, double factor)
+{
+    double_double m = two_prod(product, factor);
+    product = m.hi;
+    error = error * factor + m.lo;
+}
+
+// Once the running value overflows or turns NaN its error term is NaN too,
+// the value alone is the right answer then
+inline double add_error(double value, double error)
+{
+    return std::isfinite(error) ? value + error : value;
+}
+
+#endif
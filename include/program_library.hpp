@@ -0,0 +1,60 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef PROGRAM_LIBRARY_HPP
+#define PROGRAM_LIBRARY_HPP
+
+#include "mapped_file.hpp"
+#include "program.hpp"
+#include <utility>
+
+// Version 2 layout, native byte order, every section 8 byte aligned:
+//   header        magic "W32CPRG", version, entry count, index offset, file size
+//   entries       per program: entry header, constants, constant rounding
+//                 errors, code, name, variable names
+//   index         (name hash, entry offset) records sorted by name hash
+const uint32_t PROGRAM_LIBRARY_VERSION = 2;
+
+// A set of named compiled expressions written once and then memory mapped.
+// Opening only checks the header, lookups binary search the index, and the
+// returned views point into the mapping, so nothing is parsed or copied.
+class program_library
+{
+public:
+    static void write(const std::string& path, const std::vector<std::pair<std::string, program>>& programs);
+
+    explicit program_library(const std::string& path);
+
+    size_t size() const;
+    // The view stays valid for the lifetime of the library, find() verifies
+    // the program before handing it out
+    bool find(const std::string& name, program_view& out) const;
+    // Same, but also require the stored program to come from this source
+    bool find(const std::string& name, const std::string& source, program_view& out) const;
+
+private:
+    mapped_file file;
+};
+
+#endif
@@ -0,0 +1,84 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef RATIONAL_HPP
+#define RATIONAL_HPP
+
+#include "big_int.hpp"
+
+// Exact fraction. Values start out as a pair of 64-bit words and are only
+// promoted to big_int when an operation would overflow. Results are not
+// reduced after every operation: big values are reduced once their size
+// crosses a threshold, and normalize() gives the canonical form.
+// The denominator is always positive.
+class rational
+{
+public:
+    rational() : small(true), snum(0), sden(1), reduce_at(0) {}
+    rational(int64_t value) : small(true), snum(value), sden(1), reduce_at(0) {}
+
+    // Decimal literal such as "12.5", read exactly as 125/10
+    static rational from_literal(const std::string& text);
+
+    rational operator-() const;
+    rational& operator+=(const rational& rhs);
+    rational& operator-=(const rational& rhs);
+    rational& operator*=(const rational& rhs);
+    rational& operator/=(const rational& rhs);
+
+    // Reduce to lowest terms and move back to machine words when it fits
+    void normalize();
+    bool is_small() const { return small; }
+    bool is_zero() const { return small ? snum == 0 : num.is_zero(); }
+    bool is_negative() const { return small ? snum < 0 : num.is_negative(); }
+    // "p" for integers, "p/q" otherwise, call normalize() first for lowest terms
+    std::string to_string() const;
+
+    // -1, 0 or 1 as a is less than, equal to or greater than b
+    static int compare(const rational& a, const rational& b);
+
+private:
+    void apply(const rational& rhs, char op);
+    void promote();
+    void reduce();
+
+    bool small;
+    int64_t snum, sden;
+    big_int num, den;
+    size_t reduce_at;
+};
+
+inline rational operator+(rational a, const rational& b) { return a += b; }
+inline rational operator-(rational a, const rational& b) { return a -= b; }
+inline rational operator*(rational a, const rational& b) { return a *= b; }
+inline rational operator/(rational a, const rational& b) { return a /= b; }
+
+inline bool operator==(const rational& a, const rational& b) { return rational::compare(a, b) == 0; }
+inline bool operator!=(const rational& a, const rational& b) { return rational::compare(a, b) != 0; }
+inline bool operator<(const rational& a, const rational& b) { return rational::compare(a, b) < 0; }
+inline bool operator>(const rational& a, const rational& b) { return rational::compare(a, b) > 0; }
+inline bool operator<=(const rational& a, const rational& b) { return rational::compare(a, b) <= 0; }
+inline bool operator>=(const rational& a, const rational& b) { return rational::compare(a, b) >= 0; }
+
+#endif
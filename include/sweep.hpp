@@ -0,0 +1,83 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef SWEEP_HPP
+#define SWEEP_HPP
+
+#include "program.hpp"
+#include <functional>
+#include <iosfwd>
+
+// Rows per block handed to the sink
+const size_t SWEEP_BLOCK = 4096;
+
+// variable takes start, start + step, ... up to and including stop
+struct sweep_range
+{
+    std::string variable;
+    double start;
+    double stop;
+    double step;
+};
+
+// One block of a sweep. columns[j] holds the value of ranges[j] for each
+// row, results the program's value. Only valid during the sink call.
+struct sweep_block
+{
+    const double* const* columns;
+    size_t column_count;
+    const double* results;
+    size_t rows;
+    uint64_t first_row;
+};
+
+typedef std::function<void(const sweep_block&)> sweep_sink;
+
+// Points a range yields, throws if the step is zero or points away from stop
+uint64_t sweep_points(const sweep_range& range);
+// Evaluate p over the grid spanned by ranges, the last range varying
+// fastest. Values are computed as start + i * step, so long ranges do not
+// drift. Rows are generated and evaluated SWEEP_BLOCK at a time with
+// run_batch, memory use does not depend on the grid size. Every variable
+// of the program needs a range. Returns the number of rows.
+uint64_t sweep(const program_view& p, const std::vector<sweep_range>& ranges, const sweep_sink& sink);
+
+// Sink that writes delimited text, a header line with the range names and
+// "result", then one line per row. Each block is formatted into one buffer
+// and written with a single call.
+class table_writer
+{
+public:
+    table_writer(std::ostream& out, const std::vector<sweep_range>& ranges, char separator = ',');
+
+    void operator()(const sweep_block& block);
+
+private:
+    std::ostream& out;
+    std::string header;
+    std::vector<char> buffer;
+    char separator;
+};
+
+#endif
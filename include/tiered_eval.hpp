@@ -0,0 +1,74 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef TIERED_EVAL_HPP
+#define TIERED_EVAL_HPP
+
+#include "program.hpp"
+#include <memory>
+#include <unordered_map>
+
+// Calls after which an expression is compiled
+const uint32_t PROMOTE_AFTER = 8;
+// Expressions tracked before cold ones are forgotten
+const size_t TIERED_CAPACITY = 1024;
+
+struct tier_stats
+{
+    uint64_t calls;  // Evaluations so far, halved while uncompiled on eviction
+    bool compiled;   // Runs as a compiled program
+};
+
+// Evaluates variable-free expressions, counting calls per source text.
+// The first calls go through evaluate_direct(); once an expression has
+// been seen promote_after times it is compiled and later calls only run
+// the program. Both tiers give the same value as evaluate(). Not thread
+// safe, give each thread its own.
+class tiered_evaluator
+{
+public:
+    explicit tiered_evaluator(uint32_t promote_after = PROMOTE_AFTER, size_t capacity = TIERED_CAPACITY);
+
+    double evaluate(const std::string& infix, tier_stats* stats = nullptr);
+    // Counters of one expression, zero calls if it is not tracked
+    tier_stats stats(const std::string& infix) const;
+    size_t compiled_count() const { return compiled; }
+
+private:
+    struct entry
+    {
+        uint64_t calls;
+        std::unique_ptr<program> prog;
+        program_view view;
+    };
+
+    void evict();
+
+    std::unordered_map<std::string, entry> entries;
+    uint32_t promote_after;
+    size_t capacity;
+    size_t compiled;
+};
+
+#endif
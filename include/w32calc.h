@@ -0,0 +1,124 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#ifndef W32CALC_H
+#define W32CALC_H
+
+/*
+C interface to the expression engine, for use from other languages.
+
+Strings are passed as pointer + length and need not be NUL terminated.
+Every call returns a status code and never lets an exception escape;
+w32calc_last_error() describes the last failure on the calling thread.
+Batch calls work on caller-owned column arrays, one crossing evaluates
+any number of rows.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(W32CALC_BUILD_SHARED)
+#define W32CALC_API __declspec(dllexport)
+#elif defined(W32CALC_SHARED)
+#define W32CALC_API __declspec(dllimport)
+#else
+#define W32CALC_API
+#endif
+#else
+#define W32CALC_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a signature or struct in this header changes */
+#define W32CALC_ABI_VERSION 1
+
+typedef enum w32calc_status
+{
+    W32CALC_OK = 0,
+    W32CALC_ERROR_ARGUMENT = 1, /* Null pointer, bad slot or column count */
+    W32CALC_ERROR_EXPRESSION = 2, /* Syntax error or failed evaluation */
+    W32CALC_ERROR_BUFFER = 3, /* Output buffer too small */
+    W32CALC_ERROR_MEMORY = 4
+} w32calc_status;
+
+typedef enum w32calc_mode
+{
+    W32CALC_MODE_FLOATING = 0,
+    W32CALC_MODE_INTEGER = 1,
+    W32CALC_MODE_RATIONAL = 2,
+    W32CALC_MODE_DOUBLE_DOUBLE = 3
+} w32calc_mode;
+
+/* Compiled expression, immutable once created and safe to share between threads */
+typedef struct w32calc_program w32calc_program;
+
+W32CALC_API int w32calc_abi_version(void);
+/* Message of the most recent failed call on this thread */
+W32CALC_API const char* w32calc_last_error(void);
+
+/* Evaluate once and format the result. out_len receives the length without
+   the terminating NUL; on W32CALC_ERROR_BUFFER it is the size needed. */
+W32CALC_API w32calc_status w32calc_evaluate(const char* expr, size_t expr_len, w32calc_mode mode,
+                                            char* out, size_t out_size, size_t* out_len);
+W32CALC_API w32calc_status w32calc_evaluate_double(const char* expr, size_t expr_len, double* out);
+
+W32CALC_API w32calc_status w32calc_compile(const char* expr, size_t expr_len, w32calc_program** out);
+W32CALC_API void w32calc_program_free(w32calc_program* program);
+/* Variables get one slot each, numbered in order of first appearance */
+W32CALC_API uint32_t w32calc_program_variable_count(const w32calc_program* program);
+/* The name stays valid as long as the program */
+W32CALC_API w32calc_status w32calc_program_variable_name(const w32calc_program* program, uint32_t slot, const char** name);
+W32CALC_API w32calc_status w32calc_program_find_variable(const w32calc_program* program, const char* name, size_t name_len, uint32_t* slot);
+
+/* variables holds variable_count values in slot order */
+W32CALC_API w32calc_status w32calc_run(const w32calc_program* program, const double* variables, size_t variable_count, double* out);
+/* columns[slot] points at rows values of that variable */
+W32CALC_API w32calc_status w32calc_run_batch(const w32calc_program* program, const double* const* columns, size_t column_count,
+                                             double* out, size_t rows);
+/* Double-double precision, each result is out_hi[i] + out_lo[i] */
+W32CALC_API w32calc_status w32calc_run_batch_dd(const w32calc_program* program, const double* const* columns, size_t column_count,
+                                                double* out_hi, double* out_lo, size_t rows);
+/* Single precision, rows whose error bound exceeds tolerance * |result|
+   are recomputed in double; recomputed receives their count (may be null) */
+W32CALC_API w32calc_status w32calc_run_batch_f32(const w32calc_program* program, const float* const* columns, size_t column_count,
+                                                 float* out, size_t rows, float tolerance, size_t* recomputed);
+/* Guaranteed enclosures: out_lo[i] <= exact result <= out_hi[i] for any
+   inputs within [lo_columns[slot][i], hi_columns[slot][i]] */
+W32CALC_API w32calc_status w32calc_run_batch_interval(const w32calc_program* program, const double* const* lo_columns,
+                                                      const double* const* hi_columns, size_t column_count,
+                                                      double* out_lo, double* out_hi, size_t rows);
+/* Values plus gradients[j][i] = d(result i) / d(variable wrt[j]) */
+W32CALC_API w32calc_status w32calc_run_batch_gradient(const w32calc_program* program, const double* const* columns, size_t column_count,
+                                                      const uint32_t* wrt, size_t wrt_count,
+                                                      double* values, double* const* gradients, size_t rows);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
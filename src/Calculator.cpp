@@ -23,7 +23,7 @@ SOFTWARE.
 */
 
 #include "Calculator.hpp"
-#include "expr_eval.hpp"
+#include <cstdlib>
 
 void Calculator::SetupCalculator(HWND hWnd)
 {
@@ -60,10 +60,37 @@ void Calculator::SetupCalculator(HWND hWnd)
         }
     }
 
-    inputBox = CreateWindowEx(0L, L"Static", input.c_str(), WS_VISIBLE | WS_CHILD, 0, 0, width, boardPos.y - 0, hWnd, NULL, NULL, NULL);
+    inputBox = CreateWindowEx(0L, L"Static", core.text().c_str(), WS_VISIBLE | WS_CHILD, 0, 0, width, boardPos.y - 0, hWnd, NULL, NULL, NULL);
     SendMessage(inputBox, WM_SETFONT, (WPARAM)hFont, MAKELPARAM(0, TRUE));
 
     DeleteObject(hFont);
+
+    const char* recordPath = std::getenv("W32CALC_RECORD");
+    if (recordPath != nullptr)
+    {
+        session.open(recordPath);
+        sessionStart = std::chrono::steady_clock::now();
+    }
+
+    std::string historyPath;
+    if (const char* path = std::getenv("W32CALC_HISTORY"))
+        historyPath = path;
+    else if (const char* appData = std::getenv("LOCALAPPDATA"))
+        historyPath = std::string(appData) + "\\W32Calc.history";
+    if (!historyPath.empty())
+    {
+        try
+        {
+            history.reset(new history_log(historyPath));
+            core.set_history(history.get());
+        }
+        catch (std::exception& e)
+        {
+            // Run without history rather than not at all, but say so
+            std::string message = "History is disabled for this window: " + std::string(e.what());
+            MessageBoxW(hWnd, str2wstr(message).c_str(), L"W32Calc", MB_ICONINFORMATION | MB_OK);
+        }
+    }
 }
 
 void Calculator::HandleCustomButton(LPARAM lParam)
@@ -167,89 +194,20 @@ void Calculator::HandleButtonInput(WPARAM wParam, HWND hWnd)
     // Handle button press
     int buttonID = LOWORD(wParam);
 
-    // special button char
-    std::vector<std::wstring> special = { L"\uE94D", L"CE", L"C", L"\uE94F", L"\uE94E" };
-    std::vector<std::wstring> op = { L"\uE948", L"\uE949", L"\uE947", L"\uE94A" };
-
     // Check if the button ID corresponds to one of our buttons
     if (buttonID >= 1 && buttonID <= buttons.size())
     {
-        int buttonIndex = buttonID - 1;
-        HWND hButton = buttons[buttonIndex];
-
-        WCHAR temp[3];
-        GetWindowText(hButton, temp, 3);
-
-        if (!Filter(special, temp))
-        {
-            if (input.size() != 0 && input[0] == L'0') input.erase(0, 1);
-            input += TranslateUnicode(temp);
-        }
-        else
-        {
-            if (wcscmp(temp, special[0].c_str()) == 0)
-            {
-                NegateNumber(input);
-            }
-            else if (wcscmp(temp, special[1].c_str()) == 0)
-            {
-                EraseFinalNumber(input);
-            }
-            else if (wcscmp(temp, special[2].c_str()) == 0)
-            {
-                input.clear();
-            }
-            else if (wcscmp(temp, special[3].c_str()) == 0)
-            {
-                if (!input.empty()) input.pop_back();
-            }
-            else if (wcscmp(temp, special[4].c_str()) == 0)
-            {
-                answer = double2wstr(evaluate(infix_to_postfix(wstr2str(input))));
-                input = answer;
-            }
-
-            
-        }
-
-
+        Dispatch(input_source::button, buttonID - 1);
         SetFocus(hWnd);
     }
 }
 
 void Calculator::HandleKeyboardInput(WPARAM wParam)
 {
-    int keyCode = (int)wParam;
-    std::wstring op = L"+-*/";
-
-    switch (keyCode)
-    {
-    case VK_BACK:
-        if(input.length() > 0)
-    {
-        input = input.substr(0, input.length() - 1);
-        SetWindowText(inputBox, input.c_str());
-    }
-        break;
-
-    case 0x0D:
-        answer = double2wstr(CalculateInput(input));
-        input = L"0";
-        break;
-
-    default:
-        for (int k = 0; k < op.size(); k++)
-        {
-            if (wParam == op[k]) input += op[k];
-        }
-
-        if (keyCode >= 0x30 && keyCode <= 0x39) /* ranges 0...9 */
-        {
-            input += (wchar_t)keyCode;
-        }
+    Dispatch(input_source::key, (uint32_t)wParam);
 
-        break;
-    }
+    if (wParam == VK_BACK)
+        SetWindowText(inputBox, core.text().c_str());
 }
 
 LRESULT Calculator::ChangeStaticColor(WPARAM wParam)
@@ -262,23 +220,12 @@ LRESULT Calculator::ChangeStaticColor(WPARAM wParam)
 
 void Calculator::UpdateInputbox(HWND hWnd)
 {
-    if (input != prevInput) {
-        if (answer.empty()) {
-            SetWindowTextW(inputBox, input.c_str());
-            RECT inputBoxRect = {};
-            GetClientRect(inputBox, &inputBoxRect);
-            InvalidateRect(hWnd, &inputBoxRect, TRUE);
-            prevInput = input;
-        }
-        else {
-            SetWindowTextW(inputBox, (prevInput + L"=" + answer).c_str());
-            RECT inputBoxRect = {};
-            GetClientRect(inputBox, &inputBoxRect);
-            InvalidateRect(hWnd, &inputBoxRect, TRUE);
-            prevInput = input;
-        }
-
-        answer.clear();
+    std::wstring display;
+    if (core.refresh(display)) {
+        SetWindowTextW(inputBox, display.c_str());
+        RECT inputBoxRect = {};
+        GetClientRect(inputBox, &inputBoxRect);
+        InvalidateRect(hWnd, &inputBoxRect, TRUE);
     }
 }
 
@@ -302,158 +249,21 @@ Vector2i Calculator::BOARD_POS(int height)
     return Vector2i(-(BUTTON_SPACING / 2), static_cast<int>(height / 4.0f - BUTTON_SPACING / 2));
 }
 
-bool Calculator::Filter(const std::vector<std::wstring>& filter, const wchar_t* target)
-{
-	for (const auto& str : filter)
-	{
-		if (wcscmp(str.c_str(), target) == 0)
-		{
-			return true; // Match found
-		}
-	}
-	return false; // No match found
-}
-
-std::wstring Calculator::TranslateUnicode(std::wstring wstr)
-{
-	std::wstring out = wstr;
-	for (int i = 0; i < out.size(); i++)
-	{
-		auto it = UnicodeMap.find(out[i]);
-		if (it != UnicodeMap.end()) {
-			out[i] = it->second;
-		}
-	}
-
-	return out;
-}
-
-void Calculator::InputParser(std::wstring input, double& num1, double& num2, wchar_t& op)
-{
-	try
-	{
-		size_t pos = std::wstring::npos;
-
-		std::wstring operators = L"+-*/", temp = L"";
-
-		for (size_t i = 0; i < input.length(); i++) {
-			if (operators.find(input[i]) != std::wstring::npos) {
-				pos = i;
-			}
-		}
-
-		if (pos != std::wstring::npos)
-		{
-			for (int i = 0; i < pos; i++)
-			{
-				temp += input[i];
-			}
-
-			num1 = std::stod(temp);
-			temp = L"";
-
-			for (int i = pos + 1; i < input.size(); i++)
-			{
-				temp += input[i];
-			}
-
-			if (temp.empty()) num2 = num1;
-			else num2 = std::stod(temp);
-
-			temp = L"";
-
-			op = input[pos];
-		}
-		else
-			num1 = std::stod(input);
-	}
-	catch (std::exception& e)
-	{
-		MessageBoxW(NULL, str2wstr(e.what()).c_str(), L"Error!", MB_ICONEXCLAMATION | MB_OK);
-	}
-}
-
-double Calculator::CalculateInput(std::wstring input)
-{
-	double num1 = 0, num2 = 0, answer = 0;
-	wchar_t op;
-	InputParser(input, num1, num2, op);
-
-	if (num1 != 0 && num2 != 0)
-	{
-		switch (op)
-		{
-		case L'+':
-			answer = num1 + num2;
-			break;
-
-		case L'-':
-			answer = num1 - num2;
-			break;
-
-		case L'*':
-			answer = num1 * num2;
-			break;
-
-		case L'/':
-			answer = num1 / num2;
-			break;
-		}
-	}
-	else
-		answer = num1;
-
-	return answer;
-}
-
-void Calculator::NegateNumber(std::wstring& input)
+void Calculator::Dispatch(input_source source, uint32_t code)
 {
-	if (wcscmp(input.c_str(), L"0") == 0)
-		return;
-
-	double num1 = 0, num2 = 0;
-	wchar_t op = L'\0';
-
-	InputParser(input, num1, num2, op);
-
-	if (op == L'\0')
-	{
-		// Only one number is present
-		num1 = -num1;
-		input = double2wstr(num1);
-	}
-	else
-	{
-		// Two numbers are present
-		num2 = -num2;
-		input = double2wstr(num1) + op + double2wstr(num2);
-	}
-}
+    input_event ev = { source, code, 0 };
+    if (session.is_open())
+    {
+        ev.time_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sessionStart).count();
+        write_event(session, ev);
+        session.flush();
+    }
 
-void Calculator::EraseFinalNumber(std::wstring& input)
-{
-	double num1 = 0, num2 = 0;
-	wchar_t op = L'\0';
-
-	InputParser(input, num1, num2, op);
-
-	if (op == L'\0')
-	{
-		input = L"0";
-	}
-	else
-	{
-		input = double2wstr(num1) + op;
-	}
-}
+    core.handle(ev);
 
-std::string Calculator::wstr2str(std::wstring wstr)
-{
-    std::string str;
-    size_t size;
-    str.resize(wstr.length());
-    wcstombs(&str[0], wstr.c_str(), wstr.size());
-    return str;
+    std::string error;
+    if (core.take_error(error))
+        MessageBoxW(NULL, str2wstr(error).c_str(), L"Error!", MB_ICONEXCLAMATION | MB_OK);
 }
 
 std::wstring Calculator::str2wstr(std::string str)
@@ -461,28 +271,3 @@ std::wstring Calculator::str2wstr(std::string str)
 	std::wstring_convert<std::codecvt_utf8_utf16<wchar_t>> converter;
 	return converter.from_bytes(str);
 }
-
-std::wstring Calculator::double2wstr(double number)
-{
-	std::wstringstream ss;
-	ss << number;
-
-	std::wstring str = ss.str();
-
-	// Find the position of the decimal point
-	size_t decimalPos = str.find(L'.');
-
-	// If a decimal point exists
-	if (decimalPos != std::wstring::npos) {
-		// Find the position of the last non-zero digit after the decimal point
-		size_t lastNonZeroPos = str.find_last_not_of(L'0');
-
-		// If there are trailing '0' digits after the decimal point
-		if (lastNonZeroPos > decimalPos) {
-			// Remove the trailing '0' digits
-			str = str.substr(0, lastNonZeroPos + 1);
-		}
-	}
-
-	return str;
-}
@@ -0,0 +1,365 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "batch_f32.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+// Rows per block, each stack slot holds a block of values and a block of
+// error bounds
+const size_t F32_BLOCK = 512;
+// Unit roundoff of float
+const float F32_UNIT = 5.9604645e-8f;
+// Smallest subnormal float, underflow loses at most half of it
+const float F32_TINY = 1.4012985e-45f;
+// 2^-100, added for every rounded product or quotient. It covers gradual
+// underflow in the result and in the bound's own terms many times over,
+// and unlike F32_TINY it keeps subnormals, which are slow on most x86
+// cores, out of the bound arithmetic for ordinary values.
+const float F32_FLOOR = 7.8886091e-31f;
+// 1 + 2^-20. The bound is itself computed in float, scaling each update
+// by this covers the few roundings it takes and keeps it an upper bound.
+const float F32_GROW = 1.00000095f;
+
+// a if c holds, else b, picked with a bit mask. The loops stay branch
+// free without speculating the float arithmetic, which -frounding-math
+// and the default -ftrapping-math rule out.
+static inline float select_bits(bool c, float a, float b)
+{
+    uint32_t mask = 0 - (uint32_t)c, x, y;
+    std::memcpy(&x, &a, sizeof(x));
+    std::memcpy(&y, &b, sizeof(y));
+    uint32_t r = (x & mask) | (y & ~mask);
+    float out;
+    std::memcpy(&out, &r, sizeof(out));
+    return out;
+}
+
+// Error of one rounded product or quotient
+static inline float rounding_error(float v)
+{
+    return F32_UNIT * std::fabs(v) + F32_FLOOR;
+}
+
+// The four arithmetic operators as value / bound pairs. Sums that land in
+// the subnormal range are exact and need no floor.
+struct f32_add
+{
+    static float value(float x, float y) { return x + y; }
+    static float bound(float, float, float ex, float ey, float r) { return F32_GROW * (ex + ey + F32_UNIT * std::fabs(r)); }
+};
+
+struct f32_sub
+{
+    static float value(float x, float y) { return x - y; }
+    static float bound(float, float, float ex, float ey, float r) { return F32_GROW * (ex + ey + F32_UNIT * std::fabs(r)); }
+};
+
+// |xy - x'y'| <= |x| ey + |y| ex + ex ey
+struct f32_mul
+{
+    static float value(float x, float y) { return x * y; }
+    static float bound(float x, float y, float ex, float ey, float r)
+    {
+        return F32_GROW * ((std::fabs(x) + ex) * ey + std::fabs(y) * ex + rounding_error(r));
+    }
+};
+
+// |a/b - a'/b'| <= (ea + |a/b| eb) / (|b| - eb), unbounded once the
+// divisor's interval reaches zero. An underflowed |a/b| eb would be scaled
+// up by a small divisor, so the numerator gets F32_TINY first when it is
+// small and the divisor inexact.
+struct f32_div
+{
+    static float value(float x, float y) { return x / y; }
+    static float bound(float, float y, float ex, float ey, float q)
+    {
+        float margin = std::fabs(y) - ey, carried = ex + std::fabs(q) * ey;
+        carried += select_bits((ey > 0) & (carried < F32_FLOOR), F32_TINY, 0.0f);
+        float e = F32_GROW * (carried / margin + rounding_error(q));
+        return select_bits(margin > 0, e, std::numeric_limits<float>::infinity());
+    }
+};
+
+// One arithmetic operator over a block. A_BOUND / B_BOUND say whether an
+// operand has a stored bound, an exact operand's bound is the constant
+// zero and is neither stored nor loaded.
+template<class Op, bool A_BOUND, bool B_BOUND>
+static void arithmetic_block(float* a, float* ae, const float* b, const float* be, size_t n)
+{
+    for(size_t k = 0; k < n; k++)
+    {
+        float x = a[k], y = b[k];
+        a[k] = Op::value(x, y);
+        ae[k] = Op::bound(x, y, A_BOUND ? ae[k] : 0.0f, B_BOUND ? be[k] : 0.0f, a[k]);
+    }
+}
+
+template<class Op>
+static void arithmetic(float* a, float* ae, const float* b, const float* be, bool a_exact, bool b_exact, size_t n)
+{
+    if(a_exact && b_exact)
+        arithmetic_block<Op, false, false>(a, ae, b, be, n);
+    else if(a_exact)
+        arithmetic_block<Op, false, true>(a, ae, b, be, n);
+    else if(b_exact)
+        arithmetic_block<Op, true, false>(a, ae, b, be, n);
+    else
+        arithmetic_block<Op, true, true>(a, ae, b, be, n);
+}
+
+// Whether the error interval around v excludes zero, an exact value always
+// settles it
+static inline bool settled(float v, float e)
+{
+    return (e == 0) | (std::fabs(v) > e);
+}
+
+// A comparison is exact when the operands' error intervals do not
+// overlap, otherwise the row has to be redone. Exact operands always
+// compare exactly.
+template<class Cmp>
+static void compare(float* a, float* ae, const float* b, const float* be, bool exact, size_t n)
+{
+    const float INF = std::numeric_limits<float>::infinity();
+    Cmp cmp;
+    if(exact)
+    {
+        for(size_t k = 0; k < n; k++) a[k] = cmp(a[k], b[k]);
+        return;
+    }
+    for(size_t k = 0; k < n; k++) { ae[k] = settled(a[k] - b[k], ae[k] + be[k]) ? 0.0f : INF; a[k] = cmp(a[k], b[k]); }
+}
+
+size_t run_batch_f32(const program_view& p, const float* const* columns, float* out, size_t rows, float tolerance)
+{
+    const size_t B = F32_BLOCK, slot_size = 2 * F32_BLOCK;
+    const float INF = std::numeric_limits<float>::infinity();
+    const float MAX_FLOAT = std::numeric_limits<float>::max();
+
+    // Constants rounded to float, with what the rounding lost
+    std::vector<float> constants(p.constant_count), constant_errors(p.constant_count);
+    for(uint32_t i = 0; i < p.constant_count; i++)
+    {
+        constants[i] = (float)p.constants[i];
+        double lost = std::fabs(p.constants[i] - (double)constants[i]);
+        constant_errors[i] = (float)lost;
+        if((double)constant_errors[i] < lost)
+            constant_errors[i] = std::nextafter(constant_errors[i], INF);
+        if(!std::isfinite(constants[i]))
+            constant_errors[i] = INF;
+    }
+
+    // Slots holding inputs and exact constants have no stored bound until
+    // an operator that needs one makes it
+    std::vector<float> regs((size_t)p.max_stack * slot_size);
+    std::vector<char> exact(p.max_stack);
+    std::vector<double> redo_values((size_t)p.variable_count * B), redo_out(B);
+    std::vector<const double*> redo_columns(p.variable_count);
+    std::vector<uint32_t> redo_rows(B);
+    for(uint32_t j = 0; j < p.variable_count; j++)
+        redo_columns[j] = redo_values.data() + j * B;
+    size_t recomputed = 0;
+    for(size_t row = 0; row < rows; row += B)
+    {
+        size_t n = std::min(B, rows - row);
+        size_t sp = 0;
+        auto store_bound = [&](size_t slot)
+        {
+            if(!exact[slot])
+                return;
+            std::fill_n(regs.data() + slot * slot_size + B, n, 0.0f);
+            exact[slot] = false;
+        };
+        for(uint32_t i = 0; i < p.code_size; i++)
+        {
+            const instruction& ins = p.code[i];
+            float* r = regs.data() + sp * slot_size;
+            float* a = r - 2 * slot_size;
+            float* b = r - slot_size;
+            float* ae = a + B;
+            float* be = b + B;
+            switch(ins.op)
+            {
+            case opcode::push_const:
+            {
+                float c = constants[ins.operand], e = constant_errors[ins.operand];
+                std::fill_n(r, n, c);
+                exact[sp] = e == 0;
+                if(e != 0)
+                    std::fill_n(r + B, n, e);
+                sp++;
+                break;
+            }
+            case opcode::load_var:
+                std::copy_n(columns[ins.operand] + row, n, r);
+                exact[sp] = true;
+                sp++;
+                break;
+            case opcode::add: arithmetic<f32_add>(a, ae, b, be, exact[sp - 2], exact[sp - 1], n); exact[sp - 2] = false; sp--; break;
+            case opcode::sub: arithmetic<f32_sub>(a, ae, b, be, exact[sp - 2], exact[sp - 1], n); exact[sp - 2] = false; sp--; break;
+            case opcode::mul: arithmetic<f32_mul>(a, ae, b, be, exact[sp - 2], exact[sp - 1], n); exact[sp - 2] = false; sp--; break;
+            case opcode::div: arithmetic<f32_div>(a, ae, b, be, exact[sp - 2], exact[sp - 1], n); exact[sp - 2] = false; sp--; break;
+            case opcode::neg:
+                for(size_t k = 0; k < n; k++) b[k] = -b[k];
+                break;
+            case opcode::lt:
+            case opcode::le:
+            case opcode::gt:
+            case opcode::ge:
+            case opcode::eq:
+            case opcode::ne:
+            {
+                bool both = exact[sp - 2] && exact[sp - 1];
+                if(!both)
+                {
+                    store_bound(sp - 2);
+                    store_bound(sp - 1);
+                }
+                switch(ins.op)
+                {
+                case opcode::lt: compare<std::less<float>>(a, ae, b, be, both, n); break;
+                case opcode::le: compare<std::less_equal<float>>(a, ae, b, be, both, n); break;
+                case opcode::gt: compare<std::greater<float>>(a, ae, b, be, both, n); break;
+                case opcode::ge: compare<std::greater_equal<float>>(a, ae, b, be, both, n); break;
+                case opcode::eq: compare<std::equal_to<float>>(a, ae, b, be, both, n); break;
+                default: compare<std::not_equal_to<float>>(a, ae, b, be, both, n); break;
+                }
+                exact[sp - 2] = both;
+                sp--;
+                break;
+            }
+            // Same for telling an operand from zero
+            case opcode::land:
+                store_bound(sp - 2);
+                store_bound(sp - 1);
+                for(size_t k = 0; k < n; k++)
+                {
+                    ae[k] = settled(a[k], ae[k]) & settled(b[k], be[k]) ? 0.0f : INF;
+                    a[k] = (a[k] != 0) & (b[k] != 0);
+                }
+                sp--;
+                break;
+            case opcode::lor:
+                store_bound(sp - 2);
+                store_bound(sp - 1);
+                for(size_t k = 0; k < n; k++)
+                {
+                    ae[k] = settled(a[k], ae[k]) & settled(b[k], be[k]) ? 0.0f : INF;
+                    a[k] = (a[k] != 0) | (b[k] != 0);
+                }
+                sp--;
+                break;
+            case opcode::lnot:
+                store_bound(sp - 1);
+                for(size_t k = 0; k < n; k++) { be[k] = settled(b[k], be[k]) ? 0.0f : INF; b[k] = b[k] == 0; }
+                break;
+            case opcode::select:
+            {
+                float* c = r - 3 * slot_size;
+                float* ce = c + B;
+                store_bound(sp - 3);
+                store_bound(sp - 2);
+                store_bound(sp - 1);
+                for(size_t k = 0; k < n; k++)
+                {
+                    bool take = c[k] != 0;
+                    ce[k] = select_bits(settled(c[k], ce[k]), select_bits(take, ae[k], be[k]), INF);
+                    c[k] = select_bits(take, a[k], b[k]);
+                }
+                sp -= 2;
+                break;
+            }
+            // Flattened chains keep their first term as the running value
+            // and push a slot for the double kernels' error term, unused here
+            case opcode::sum_begin:
+            case opcode::prod_begin:
+                store_bound(sp - 1);
+                std::fill(r, r + slot_size, 0.0f);
+                exact[sp] = false;
+                sp++;
+                break;
+            case opcode::sum_add:
+            {
+                float* s = r - 3 * slot_size;
+                float* se = s + B;
+                store_bound(sp - 1);
+                for(size_t k = 0; k < n; k++) { s[k] = s[k] + b[k]; se[k] = F32_GROW * (se[k] + be[k] + F32_UNIT * std::fabs(s[k])); }
+                sp--;
+                break;
+            }
+            case opcode::prod_mul:
+            {
+                float* s = r - 3 * slot_size;
+                float* se = s + B;
+                store_bound(sp - 1);
+                for(size_t k = 0; k < n; k++)
+                {
+                    float x = s[k], y = b[k];
+                    s[k] = x * y;
+                    se[k] = f32_mul::bound(x, y, se[k], be[k], s[k]);
+                }
+                sp--;
+                break;
+            }
+            case opcode::sum_end:
+            case opcode::prod_end:
+                sp--;
+                break;
+            }
+        }
+
+        store_bound(0);
+        // Store the block, then redo the rows that failed in double as one
+        // smaller batch. The negated test also catches NaN values and
+        // bounds.
+        size_t failed = 0;
+        for(size_t k = 0; k < n; k++)
+        {
+            float v = regs[k];
+            out[row + k] = v;
+            failed += !(std::fabs(v) <= MAX_FLOAT) | !(regs[B + k] <= tolerance * std::fabs(v));
+        }
+        if(failed == 0)
+            continue;
+        size_t m = 0;
+        for(size_t k = 0; k < n; k++)
+        {
+            float v = regs[k];
+            if(!(std::fabs(v) <= MAX_FLOAT && regs[B + k] <= tolerance * std::fabs(v)))
+                redo_rows[m++] = (uint32_t)k;
+        }
+        for(uint32_t j = 0; j < p.variable_count; j++)
+            for(size_t i = 0; i < m; i++)
+                redo_values[j * B + i] = columns[j][row + redo_rows[i]];
+        run_batch(p, redo_columns.data(), redo_out.data(), m);
+        for(size_t i = 0; i < m; i++)
+            out[row + redo_rows[i]] = (float)redo_out[i];
+        recomputed += m;
+    }
+    return recomputed;
+}
@@ -0,0 +1,258 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "batch_interval.hpp"
+#include <algorithm>
+#include <cfenv>
+#include <cmath>
+#include <limits>
+
+#ifdef _MSC_VER
+#pragma fenv_access(on)
+#endif
+
+// Rows per block, each stack slot holds a block of negated lower bounds
+// followed by a block of upper bounds
+const size_t INTERVAL_BLOCK = 256;
+
+// Restores the caller's rounding mode however the batch ends
+class rounding_guard
+{
+public:
+    explicit rounding_guard(int mode) :
+        saved(std::fegetround())
+    {
+        if(std::fesetround(mode) != 0)
+            throw std::runtime_error("Directed rounding is not available");
+    }
+    ~rounding_guard() { std::fesetround(saved); }
+
+private:
+    int saved;
+};
+
+// Larger of two bounds, a NaN candidate (0 * inf) loses to a number
+static inline double max_bound(double x, double y)
+{
+    return x > y || y != y ? x : y;
+}
+
+// Whether [lo, hi] surely / possibly contains a nonzero value
+// A bound that came out NaN (inf - inf, 0 * inf) is replaced by infinity
+static inline double widen(double bound)
+{
+    return bound == bound ? bound : std::numeric_limits<double>::infinity();
+}
+
+static inline bool surely_true(double lo, double hi)
+{
+    return lo > 0 || hi < 0;
+}
+
+static inline bool possibly_true(double lo, double hi)
+{
+    return lo != 0 || hi != 0;
+}
+
+void run_batch_interval(const program_view& p, const double* const* lo_columns, const double* const* hi_columns,
+                        double* out_lo, double* out_hi, size_t rows)
+{
+    const size_t B = INTERVAL_BLOCK, slot_size = 2 * INTERVAL_BLOCK;
+    const double INF = std::numeric_limits<double>::infinity();
+
+    // The exact value of a literal is constants + constants_lo. The tail
+    // only says which side it lies on while it is finite and the literal
+    // is not so small that the tail lost precision, otherwise the literal
+    // gets one ulp on both sides
+    const double TAIL_LIMIT = 2.0041683600089728e-292; // 2^-969
+    std::vector<double> constants_nlo(p.constant_count), constants_hi(p.constant_count);
+    for(uint32_t i = 0; i < p.constant_count; i++)
+    {
+        double c = p.constants[i], e = p.constants_lo[i];
+        bool trusted = std::isfinite(e) && std::isfinite(c) &&
+                       (std::fabs(c) >= TAIL_LIMIT || (c == 0 && !std::signbit(e)));
+        bool below = !trusted || e < 0, above = !trusted || e > 0;
+        constants_nlo[i] = -(below ? std::nextafter(c, -INF) : c);
+        constants_hi[i] = above ? std::nextafter(c, INF) : c;
+    }
+
+    std::vector<double> regs((size_t)p.max_stack * slot_size);
+    rounding_guard rounding(FE_UPWARD);
+    for(size_t row = 0; row < rows; row += B)
+    {
+        size_t n = std::min(B, rows - row);
+        size_t sp = 0;
+        for(uint32_t i = 0; i < p.code_size; i++)
+        {
+            const instruction& ins = p.code[i];
+            double* r = regs.data() + sp * slot_size;
+            double* a = r - 2 * slot_size; // a[k] = -lo, ah[k] = hi
+            double* b = r - slot_size;
+            double* ah = a + B;
+            double* bh = b + B;
+            switch(ins.op)
+            {
+            case opcode::push_const:
+            {
+                double nlo = constants_nlo[ins.operand], hi = constants_hi[ins.operand];
+                for(size_t k = 0; k < n; k++) { r[k] = nlo; r[B + k] = hi; }
+                sp++;
+                break;
+            }
+            case opcode::load_var:
+            {
+                const double* lo = lo_columns[ins.operand] + row;
+                const double* hi = hi_columns[ins.operand] + row;
+                for(size_t k = 0; k < n; k++) { r[k] = -lo[k]; r[B + k] = hi[k]; }
+                sp++;
+                break;
+            }
+            // -(lo_a + lo_b) = -lo_a + -lo_b, both bounds round up
+            case opcode::add: for(size_t k = 0; k < n; k++) { a[k] = widen(a[k] + b[k]); ah[k] = widen(ah[k] + bh[k]); } sp--; break;
+            case opcode::sub: for(size_t k = 0; k < n; k++) { a[k] = widen(a[k] + bh[k]); ah[k] = widen(ah[k] + b[k]); } sp--; break;
+            case opcode::neg: for(size_t k = 0; k < n; k++) std::swap(b[k], bh[k]); break;
+            case opcode::mul:
+                // The four corner products, each negated lower candidate
+                // is formed from exactly negated operands
+                for(size_t k = 0; k < n; k++)
+                {
+                    double alo = -a[k], ahi = ah[k], blo = -b[k], bhi = bh[k];
+                    double nlo = max_bound(max_bound(a[k] * blo, a[k] * bhi), max_bound(-ahi * blo, -ahi * bhi));
+                    double hi = max_bound(max_bound(alo * blo, alo * bhi), max_bound(ahi * blo, ahi * bhi));
+                    a[k] = widen(nlo);
+                    ah[k] = widen(hi);
+                }
+                sp--;
+                break;
+            case opcode::div:
+                // With the divisor's sign fixed each bound is one quotient,
+                // the signs only pick its operands
+                for(size_t k = 0; k < n; k++)
+                {
+                    double alo = -a[k], ahi = ah[k], blo = -b[k], bhi = bh[k];
+                    bool positive = blo > 0, straddles = !(positive || bhi < 0);
+                    double lo_num = positive ? alo : ahi, hi_num = positive ? ahi : alo;
+                    double lo_den = lo_num >= 0 ? bhi : blo;
+                    double hi_den = hi_num >= 0 ? blo : bhi;
+                    a[k] = straddles ? INF : widen(-lo_num / lo_den);
+                    ah[k] = straddles ? INF : widen(hi_num / hi_den);
+                }
+                sp--;
+                break;
+            // Lower bound: true for every point pair, upper bound: for some
+            case opcode::lt: for(size_t k = 0; k < n; k++) { double t = ah[k] < -b[k], f = -a[k] < bh[k]; a[k] = -t; ah[k] = f; } sp--; break;
+            case opcode::le: for(size_t k = 0; k < n; k++) { double t = ah[k] <= -b[k], f = -a[k] <= bh[k]; a[k] = -t; ah[k] = f; } sp--; break;
+            case opcode::gt: for(size_t k = 0; k < n; k++) { double t = -a[k] > bh[k], f = ah[k] > -b[k]; a[k] = -t; ah[k] = f; } sp--; break;
+            case opcode::ge: for(size_t k = 0; k < n; k++) { double t = -a[k] >= bh[k], f = ah[k] >= -b[k]; a[k] = -t; ah[k] = f; } sp--; break;
+            case opcode::eq:
+            case opcode::ne:
+                for(size_t k = 0; k < n; k++)
+                {
+                    bool overlap = -a[k] <= bh[k] && -b[k] <= ah[k];
+                    bool same_point = -a[k] == ah[k] && -b[k] == bh[k] && ah[k] == bh[k];
+                    double t = ins.op == opcode::eq ? same_point : !overlap;
+                    double f = ins.op == opcode::eq ? overlap : !same_point;
+                    a[k] = -t;
+                    ah[k] = f;
+                }
+                sp--;
+                break;
+            case opcode::land:
+            case opcode::lor:
+                for(size_t k = 0; k < n; k++)
+                {
+                    bool at = surely_true(-a[k], ah[k]), bt = surely_true(-b[k], bh[k]);
+                    bool ap = possibly_true(-a[k], ah[k]), bp = possibly_true(-b[k], bh[k]);
+                    double t = ins.op == opcode::land ? at & bt : at | bt;
+                    double f = ins.op == opcode::land ? ap & bp : ap | bp;
+                    a[k] = -t;
+                    ah[k] = f;
+                }
+                sp--;
+                break;
+            case opcode::lnot:
+                for(size_t k = 0; k < n; k++)
+                {
+                    double t = !possibly_true(-b[k], bh[k]), f = !surely_true(-b[k], bh[k]);
+                    b[k] = -t;
+                    bh[k] = f;
+                }
+                break;
+            case opcode::select:
+            {
+                // An undecided condition takes the hull of both branches
+                double* c = r - 3 * slot_size;
+                double* ch = c + B;
+                for(size_t k = 0; k < n; k++)
+                {
+                    bool take_a = surely_true(-c[k], ch[k]), take_b = !possibly_true(-c[k], ch[k]);
+                    c[k] = take_a ? a[k] : take_b ? b[k] : std::max(a[k], b[k]);
+                    ch[k] = take_a ? ah[k] : take_b ? bh[k] : std::max(ah[k], bh[k]);
+                }
+                sp -= 2;
+                break;
+            }
+            // Compensation needs round to nearest, the error slot stays zero
+            case opcode::sum_begin:
+            case opcode::prod_begin:
+                std::fill(r, r + slot_size, 0.0);
+                sp++;
+                break;
+            case opcode::sum_add:
+            {
+                double* s = r - 3 * slot_size;
+                double* sh = s + B;
+                for(size_t k = 0; k < n; k++) { s[k] = widen(s[k] + b[k]); sh[k] = widen(sh[k] + bh[k]); }
+                sp--;
+                break;
+            }
+            case opcode::prod_mul:
+            {
+                double* s = r - 3 * slot_size;
+                double* sh = s + B;
+                for(size_t k = 0; k < n; k++)
+                {
+                    double slo = -s[k], shi = sh[k], blo = -b[k], bhi = bh[k];
+                    double nlo = max_bound(max_bound(s[k] * blo, s[k] * bhi), max_bound(-shi * blo, -shi * bhi));
+                    double hi = max_bound(max_bound(slo * blo, slo * bhi), max_bound(shi * blo, shi * bhi));
+                    s[k] = widen(nlo);
+                    sh[k] = widen(hi);
+                }
+                sp--;
+                break;
+            }
+            case opcode::sum_end:
+            case opcode::prod_end:
+                sp--;
+                break;
+            }
+        }
+
+        for(size_t k = 0; k < n; k++)
+        {
+            out_lo[row + k] = 0.0 - widen(regs[k]); // Upward rounding makes 0 - 0 = +0
+            out_hi[row + k] = widen(regs[B + k]);
+        }
+    }
+}
@@ -0,0 +1,621 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "big_int.hpp"
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Operand sizes (in limbs) above which the faster multiplications kick in
+const size_t KARATSUBA_THRESHOLD = 32;
+const size_t TOOM3_THRESHOLD = 192;
+
+typedef std::vector<uint32_t> magnitude;
+
+static void trim_mag(magnitude& a)
+{
+    while(!a.empty() && a.back() == 0)
+        a.pop_back();
+}
+
+static int compare_mag(const magnitude& a, const magnitude& b)
+{
+    if(a.size() != b.size())
+        return a.size() < b.size() ? -1 : 1;
+    for(size_t i = a.size(); i-- > 0;)
+    {
+        if(a[i] != b[i])
+            return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+static magnitude add_mag(const magnitude& a, const magnitude& b)
+{
+    const magnitude& l = a.size() >= b.size() ? a : b;
+    const magnitude& s = a.size() >= b.size() ? b : a;
+    magnitude out(l.size() + 1);
+    uint64_t carry = 0;
+    for(size_t i = 0; i < l.size(); i++)
+    {
+        carry += (uint64_t)l[i] + (i < s.size() ? s[i] : 0);
+        out[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    out[l.size()] = (uint32_t)carry;
+    trim_mag(out);
+    return out;
+}
+
+// Requires a >= b
+static magnitude sub_mag(const magnitude& a, const magnitude& b)
+{
+    magnitude out(a.size());
+    int64_t borrow = 0;
+    for(size_t i = 0; i < a.size(); i++)
+    {
+        int64_t d = (int64_t)a[i] - (i < b.size() ? b[i] : 0) - borrow;
+        borrow = d < 0;
+        out[i] = (uint32_t)(d + (borrow << 32));
+    }
+    trim_mag(out);
+    return out;
+}
+
+// out += x * base^shift, out must be large enough to hold the result
+static void add_shifted(magnitude& out, const magnitude& x, size_t shift)
+{
+    uint64_t carry = 0;
+    size_t i = 0;
+    for(; i < x.size(); i++)
+    {
+        carry += (uint64_t)out[i + shift] + x[i];
+        out[i + shift] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    for(; carry != 0; i++)
+    {
+        carry += out[i + shift];
+        out[i + shift] = (uint32_t)carry;
+        carry >>= 32;
+    }
+}
+
+// a -= b in place, requires a >= b
+static void sub_mag_inplace(magnitude& a, const magnitude& b)
+{
+    int64_t borrow = 0;
+    for(size_t i = 0; i < a.size() && (i < b.size() || borrow != 0); i++)
+    {
+        int64_t d = (int64_t)a[i] - (i < b.size() ? b[i] : 0) - borrow;
+        borrow = d < 0;
+        a[i] = (uint32_t)(d + (borrow << 32));
+    }
+    trim_mag(a);
+}
+
+static unsigned ctz32(uint32_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, x);
+    return index;
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+static size_t trailing_zero_bits(const magnitude& a)
+{
+    size_t i = 0;
+    while(a[i] == 0)
+        i++;
+    return i * 32 + ctz32(a[i]);
+}
+
+static void shift_right(magnitude& a, size_t bits)
+{
+    size_t limbs = bits / 32, rem = bits % 32;
+    a.erase(a.begin(), a.begin() + std::min(limbs, a.size()));
+    if(rem != 0)
+    {
+        for(size_t i = 0; i < a.size(); i++)
+            a[i] = (a[i] >> rem) | (i + 1 < a.size() ? (uint32_t)((uint64_t)a[i + 1] << (32 - rem)) : 0);
+    }
+    trim_mag(a);
+}
+
+static void shift_left(magnitude& a, size_t bits)
+{
+    size_t limbs = bits / 32, rem = bits % 32;
+    if(rem != 0)
+    {
+        a.push_back(0);
+        for(size_t i = a.size() - 1; i > 0; i--)
+            a[i] = (a[i] << rem) | (uint32_t)((uint64_t)a[i - 1] >> (32 - rem));
+        a[0] <<= rem;
+    }
+    a.insert(a.begin(), limbs, 0);
+    trim_mag(a);
+}
+
+static uint64_t to_u64(const magnitude& a)
+{
+    return (a.size() > 0 ? a[0] : 0) | (a.size() > 1 ? (uint64_t)a[1] << 32 : 0);
+}
+
+static magnitude slice_mag(const magnitude& a, size_t begin, size_t count)
+{
+    if(begin >= a.size())
+        return magnitude();
+    magnitude out(a.begin() + begin, a.begin() + std::min(a.size(), begin + count));
+    trim_mag(out);
+    return out;
+}
+
+static magnitude mul_schoolbook(const magnitude& a, const magnitude& b)
+{
+    magnitude out(a.size() + b.size());
+    for(size_t i = 0; i < a.size(); i++)
+    {
+        uint64_t carry = 0;
+        for(size_t j = 0; j < b.size(); j++)
+        {
+            carry += (uint64_t)a[i] * b[j] + out[i + j];
+            out[i + j] = (uint32_t)carry;
+            carry >>= 32;
+        }
+        out[i + b.size()] = (uint32_t)carry;
+    }
+    trim_mag(out);
+    return out;
+}
+
+static uint32_t divmod_small(magnitude& a, uint32_t d)
+{
+    uint64_t rem = 0;
+    for(size_t i = a.size(); i-- > 0;)
+    {
+        uint64_t cur = (rem << 32) | a[i];
+        a[i] = (uint32_t)(cur / d);
+        rem = cur % d;
+    }
+    trim_mag(a);
+    return (uint32_t)rem;
+}
+
+static void mul_small_add(magnitude& a, uint32_t m, uint32_t add)
+{
+    uint64_t carry = add;
+    for(size_t i = 0; i < a.size(); i++)
+    {
+        carry += (uint64_t)a[i] * m;
+        a[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+    if(carry != 0)
+        a.push_back((uint32_t)carry);
+}
+
+// Knuth's algorithm D, v must have at least two limbs and u >= v
+static void divmod_knuth(const magnitude& u, const magnitude& v, magnitude& q, magnitude& r)
+{
+    const uint64_t base = 1ULL << 32;
+    size_t m = u.size(), n = v.size();
+
+    int s = 0;
+    for(uint32_t top = v[n - 1]; (top & 0x80000000u) == 0; top <<= 1)
+        s++;
+
+    magnitude vn(n), un(m + 1);
+    for(size_t i = n - 1; i > 0; i--)
+        vn[i] = (v[i] << s) | (s ? (uint32_t)((uint64_t)v[i - 1] >> (32 - s)) : 0);
+    vn[0] = v[0] << s;
+    un[m] = s ? (uint32_t)((uint64_t)u[m - 1] >> (32 - s)) : 0;
+    for(size_t i = m - 1; i > 0; i--)
+        un[i] = (u[i] << s) | (s ? (uint32_t)((uint64_t)u[i - 1] >> (32 - s)) : 0);
+    un[0] = u[0] << s;
+
+    q.assign(m - n + 1, 0);
+    for(size_t j = m - n + 1; j-- > 0;)
+    {
+        uint64_t num = ((uint64_t)un[j + n] << 32) | un[j + n - 1];
+        uint64_t qhat = num / vn[n - 1];
+        uint64_t rhat = num % vn[n - 1];
+        while(qhat >= base || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2]))
+        {
+            qhat--;
+            rhat += vn[n - 1];
+            if(rhat >= base)
+                break;
+        }
+
+        // Multiply and subtract
+        int64_t k = 0, t;
+        for(size_t i = 0; i < n; i++)
+        {
+            uint64_t p = qhat * vn[i];
+            t = (int64_t)un[i + j] - k - (int64_t)(p & 0xFFFFFFFFu);
+            un[i + j] = (uint32_t)t;
+            k = (int64_t)(p >> 32) - (t >> 32);
+        }
+        t = (int64_t)un[j + n] - k;
+        un[j + n] = (uint32_t)t;
+
+        q[j] = (uint32_t)qhat;
+        if(t < 0) // Estimate was one too large, add back
+        {
+            q[j]--;
+            uint64_t c = 0;
+            for(size_t i = 0; i < n; i++)
+            {
+                c += (uint64_t)un[i + j] + vn[i];
+                un[i + j] = (uint32_t)c;
+                c >>= 32;
+            }
+            un[j + n] += (uint32_t)c;
+        }
+    }
+
+    r.assign(n, 0);
+    for(size_t i = 0; i < n; i++)
+        r[i] = (un[i] >> s) | (s ? (uint32_t)((uint64_t)un[i + 1] << (32 - s)) : 0);
+    trim_mag(q);
+    trim_mag(r);
+}
+
+big_int::big_int(int64_t value) : negative(value < 0)
+{
+    uint64_t mag = negative ? 0 - (uint64_t)value : (uint64_t)value;
+    while(mag != 0)
+    {
+        limbs.push_back((uint32_t)mag);
+        mag >>= 32;
+    }
+}
+
+big_int::big_int(magnitude mag, bool neg) : limbs(std::move(mag)), negative(neg)
+{
+    trim();
+}
+
+bool big_int::fits_int64() const
+{
+    if(limbs.size() > 2)
+        return false;
+    uint64_t mag = to_u64(limbs);
+    return negative ? mag <= (1ULL << 63) : mag < (1ULL << 63);
+}
+
+int64_t big_int::to_int64() const
+{
+    uint64_t mag = to_u64(limbs);
+    return negative ? (int64_t)(0 - mag) : (int64_t)mag;
+}
+
+void big_int::trim()
+{
+    trim_mag(limbs);
+    if(limbs.empty())
+        negative = false;
+}
+
+big_int big_int::from_string(const std::string& digits)
+{
+    size_t pos = 0;
+    bool neg = false;
+    if(pos < digits.size() && (digits[pos] == '-' || digits[pos] == '+'))
+        neg = digits[pos++] == '-';
+    if(pos == digits.size())
+        throw std::runtime_error("Invalid number format");
+
+    magnitude mag;
+    // Consume 9 decimal digits per step, the first chunk takes the remainder
+    size_t chunk = (digits.size() - pos) % 9;
+    if(chunk == 0)
+        chunk = 9;
+    while(pos < digits.size())
+    {
+        uint32_t value = 0, scale = 1;
+        for(size_t i = 0; i < chunk; i++, pos++)
+        {
+            if(!std::isdigit((unsigned char)digits[pos]))
+                throw std::runtime_error("Invalid number format");
+            value = value * 10 + (digits[pos] - '0');
+            scale *= 10;
+        }
+        mul_small_add(mag, scale, value);
+        chunk = 9;
+    }
+    return big_int(mag, neg);
+}
+
+std::string big_int::to_string() const
+{
+    if(limbs.empty())
+        return "0";
+
+    magnitude mag = limbs;
+    std::vector<uint32_t> chunks;
+    while(!mag.empty())
+        chunks.push_back(divmod_small(mag, 1000000000u));
+
+    std::string out = negative ? "-" : "";
+    out += std::to_string(chunks.back());
+    for(size_t i = chunks.size() - 1; i-- > 0;)
+    {
+        std::string part = std::to_string(chunks[i]);
+        out.append(9 - part.size(), '0');
+        out += part;
+    }
+    return out;
+}
+
+big_int big_int::operator-() const
+{
+    big_int out = *this;
+    if(!out.limbs.empty())
+        out.negative = !out.negative;
+    return out;
+}
+
+big_int& big_int::operator+=(const big_int& rhs)
+{
+    if(negative == rhs.negative)
+    {
+        limbs = add_mag(limbs, rhs.limbs);
+    }
+    else if(compare_mag(limbs, rhs.limbs) >= 0)
+    {
+        limbs = sub_mag(limbs, rhs.limbs);
+    }
+    else
+    {
+        limbs = sub_mag(rhs.limbs, limbs);
+        negative = rhs.negative;
+    }
+    trim();
+    return *this;
+}
+
+big_int& big_int::operator-=(const big_int& rhs)
+{
+    return *this += -rhs;
+}
+
+big_int& big_int::operator*=(const big_int& rhs)
+{
+    limbs = multiply(limbs, rhs.limbs);
+    negative = negative != rhs.negative;
+    trim();
+    return *this;
+}
+
+big_int& big_int::operator/=(const big_int& rhs)
+{
+    big_int rem;
+    divmod(*this, rhs, *this, rem);
+    return *this;
+}
+
+big_int& big_int::operator%=(const big_int& rhs)
+{
+    big_int quot;
+    divmod(*this, rhs, quot, *this);
+    return *this;
+}
+
+void big_int::divmod(const big_int& a, const big_int& b, big_int& quot, big_int& rem)
+{
+    if(b.is_zero())
+        throw std::runtime_error("Division by zero");
+
+    bool qneg = a.negative != b.negative, rneg = a.negative;
+    magnitude q, r;
+    if(compare_mag(a.limbs, b.limbs) < 0)
+    {
+        r = a.limbs;
+    }
+    else if(b.limbs.size() == 1)
+    {
+        q = a.limbs;
+        uint32_t small = divmod_small(q, b.limbs[0]);
+        if(small != 0)
+            r.push_back(small);
+    }
+    else
+    {
+        divmod_knuth(a.limbs, b.limbs, q, r);
+    }
+    quot = big_int(q, qneg);
+    rem = big_int(r, rneg);
+}
+
+int big_int::compare(const big_int& a, const big_int& b)
+{
+    if(a.negative != b.negative)
+        return a.negative ? -1 : 1;
+    int mag = compare_mag(a.limbs, b.limbs);
+    return a.negative ? -mag : mag;
+}
+
+big_int big_int::gcd(const big_int& a, const big_int& b)
+{
+    magnitude u = a.limbs, v = b.limbs;
+    if(u.empty())
+        return big_int(v, false);
+    if(v.empty())
+        return big_int(u, false);
+
+    size_t zu = trailing_zero_bits(u), zv = trailing_zero_bits(v);
+    size_t shift = std::min(zu, zv);
+    shift_right(u, zu);
+    shift_right(v, zv);
+
+    // Both odd from here on
+    while(true)
+    {
+        if(u.size() <= 2 && v.size() <= 2)
+        {
+            uint64_t x = to_u64(u), y = to_u64(v);
+            while(x != y)
+            {
+                if(x < y)
+                    std::swap(x, y);
+                x -= y;
+                x >>= (uint32_t)x != 0 ? ctz32((uint32_t)x) : 32 + ctz32((uint32_t)(x >> 32));
+            }
+            u.assign({ (uint32_t)x, (uint32_t)(x >> 32) });
+            trim_mag(u);
+            break;
+        }
+
+        int c = compare_mag(u, v);
+        if(c == 0)
+            break;
+        if(c < 0)
+            std::swap(u, v);
+
+        // A single Euclidean step keeps the subtraction loop from crawling
+        // when the operands differ in length by more than one limb
+        if(u.size() > v.size() + 1)
+        {
+            magnitude q, r;
+            if(v.size() == 1)
+            {
+                uint32_t small = divmod_small(u, v[0]);
+                r.assign(small != 0 ? 1 : 0, small);
+            }
+            else
+            {
+                divmod_knuth(u, v, q, r);
+            }
+            if(r.empty())
+            {
+                u = v;
+                break;
+            }
+            u.swap(r);
+            shift_right(u, trailing_zero_bits(u));
+            continue;
+        }
+
+        sub_mag_inplace(u, v);
+        shift_right(u, trailing_zero_bits(u));
+    }
+
+    shift_left(u, shift);
+    return big_int(u, false);
+}
+
+magnitude big_int::multiply(const magnitude& a, const magnitude& b)
+{
+    const magnitude& l = a.size() >= b.size() ? a : b;
+    const magnitude& s = a.size() >= b.size() ? b : a;
+    if(s.empty())
+        return magnitude();
+    if(s.size() < KARATSUBA_THRESHOLD)
+        return mul_schoolbook(l, s);
+
+    // Unbalanced operands, multiply the long one in slices the size of the short one
+    if(2 * s.size() <= l.size())
+    {
+        magnitude out(l.size() + s.size() + 1);
+        for(size_t begin = 0; begin < l.size(); begin += s.size())
+            add_shifted(out, multiply(slice_mag(l, begin, s.size()), s), begin);
+        trim_mag(out);
+        return out;
+    }
+
+    if(s.size() >= TOOM3_THRESHOLD)
+        return multiply_toom3(l, s);
+    return multiply_karatsuba(l, s);
+}
+
+magnitude big_int::multiply_karatsuba(const magnitude& a, const magnitude& b)
+{
+    size_t k = std::max(a.size(), b.size()) / 2;
+    magnitude a0 = slice_mag(a, 0, k), a1 = slice_mag(a, k, a.size());
+    magnitude b0 = slice_mag(b, 0, k), b1 = slice_mag(b, k, b.size());
+
+    magnitude z0 = multiply(a0, b0);
+    magnitude z2 = multiply(a1, b1);
+    magnitude z1 = multiply(add_mag(a0, a1), add_mag(b0, b1));
+    z1 = sub_mag(sub_mag(z1, z0), z2);
+
+    magnitude out(a.size() + b.size() + 2);
+    add_shifted(out, z0, 0);
+    add_shifted(out, z1, k);
+    add_shifted(out, z2, 2 * k);
+    trim_mag(out);
+    return out;
+}
+
+magnitude big_int::multiply_toom3(const magnitude& a, const magnitude& b)
+{
+    size_t k = (std::max(a.size(), b.size()) + 2) / 3;
+    big_int a0(slice_mag(a, 0, k), false), a1(slice_mag(a, k, k), false), a2(slice_mag(a, 2 * k, a.size()), false);
+    big_int b0(slice_mag(b, 0, k), false), b1(slice_mag(b, k, k), false), b2(slice_mag(b, 2 * k, b.size()), false);
+
+    // Evaluate both polynomials at 0, 1, -1, -2 and infinity
+    big_int pa = a0 + a2, pb = b0 + b2;
+    big_int pa1 = pa + a1, pb1 = pb + b1;
+    big_int pam1 = pa - a1, pbm1 = pb - b1;
+    big_int pam2 = pam1 + a2, pbm2 = pbm1 + b2;
+    pam2 = pam2 + pam2 - a0;
+    pbm2 = pbm2 + pbm2 - b0;
+
+    big_int r0 = a0 * b0;
+    big_int r1 = pa1 * pb1;
+    big_int rm1 = pam1 * pbm1;
+    big_int rm2 = pam2 * pbm2;
+    big_int rinf = a2 * b2;
+
+    // Interpolate (Bodrato's sequence), every division here is exact
+    big_int c3 = rm2 - r1;
+    divmod_small(c3.limbs, 3);
+    c3.trim();
+    big_int c1 = r1 - rm1;
+    divmod_small(c1.limbs, 2);
+    c1.trim();
+    big_int c2 = rm1 - r0;
+    c3 = c2 - c3;
+    divmod_small(c3.limbs, 2);
+    c3.trim();
+    c3 += rinf + rinf;
+    c2 += c1 - rinf;
+    c1 -= c3;
+
+    magnitude out(a.size() + b.size() + 2 * k);
+    add_shifted(out, r0.limbs, 0);
+    add_shifted(out, c1.limbs, k);
+    add_shifted(out, c2.limbs, 2 * k);
+    add_shifted(out, c3.limbs, 3 * k);
+    add_shifted(out, rinf.limbs, 4 * k);
+    trim_mag(out);
+    return out;
+}
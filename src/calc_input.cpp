@@ -0,0 +1,304 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "calc_input.hpp"
+#include "expr_eval.hpp"
+#include "history_log.hpp"
+#include <ctime>
+#include <cstdlib>
+#include <cwchar>
+#include <istream>
+#include <ostream>
+#include <sstream>
+
+const wchar_t* const BUTTON_LABELS[BUTTON_ROWS][BUTTON_COLUMNS] =
+{
+    {L"\uE94D", L"CE", L"C", L"\uE94F"},
+    {L"7",      L"8",  L"9", L"\uE94A"},
+    {L"4",      L"5",  L"6", L"\uE947"},
+    {L"1",      L"2",  L"3", L"\uE949"},
+    {L"\uE94E", L"0",  L".", L"\uE948"}
+};
+
+// Buttons that act on the input instead of appending their caption
+static const wchar_t NEGATE[] = L"\uE94D";
+static const wchar_t CLEAR_ENTRY[] = L"CE";
+static const wchar_t CLEAR[] = L"C";
+static const wchar_t BACKSPACE[] = L"\uE94F";
+static const wchar_t EQUALS[] = L"\uE94E";
+
+// Operator glyphs to their ASCII form
+static wchar_t translate_glyph(wchar_t c)
+{
+    switch(c)
+    {
+    case L'\uE948': return L'+';
+    case L'\uE949': return L'-';
+    case L'\uE947': return L'*';
+    case L'\uE94A': return L'/';
+    default: return c;
+    }
+}
+
+static std::string wstr2str(const std::wstring& wstr)
+{
+    std::string str;
+    str.resize(wstr.length());
+    wcstombs(&str[0], wstr.c_str(), wstr.size());
+    return str;
+}
+
+std::wstring double2wstr(double number)
+{
+    std::wstringstream ss;
+    ss << number;
+
+    std::wstring str = ss.str();
+
+    // Drop trailing '0' digits after the decimal point
+    size_t decimalPos = str.find(L'.');
+    if(decimalPos != std::wstring::npos)
+    {
+        size_t lastNonZeroPos = str.find_last_not_of(L'0');
+        if(lastNonZeroPos > decimalPos)
+            str = str.substr(0, lastNonZeroPos + 1);
+    }
+    return str;
+}
+
+std::vector<std::vector<std::wstring>> button_grid()
+{
+    std::vector<std::vector<std::wstring>> grid(BUTTON_ROWS);
+    for(size_t row = 0; row < BUTTON_ROWS; row++)
+        grid[row].assign(BUTTON_LABELS[row], BUTTON_LABELS[row] + BUTTON_COLUMNS);
+    return grid;
+}
+
+bool evaluates(const input_event& ev)
+{
+    if(ev.source == input_source::key)
+        return ev.code == KEY_RETURN;
+    return ev.code < BUTTON_ROWS * BUTTON_COLUMNS &&
+           std::wcscmp(BUTTON_LABELS[ev.code / BUTTON_COLUMNS][ev.code % BUTTON_COLUMNS], EQUALS) == 0;
+}
+
+void calc_input::handle(const input_event& ev)
+{
+    if(ev.source == input_source::key)
+        press_key(ev.code);
+    else
+        press_button(ev.code);
+}
+
+void calc_input::press_key(uint32_t code)
+{
+    switch(code)
+    {
+    case KEY_BACK:
+        if(input.length() > 0)
+            input = input.substr(0, input.length() - 1);
+        break;
+
+    case KEY_RETURN:
+        answer = double2wstr(calculate_input(input));
+        record(input, answer);
+        input = L"0";
+        break;
+
+    default:
+        if(code == L'+' || code == L'-' || code == L'*' || code == L'/')
+            input += (wchar_t)code;
+        else if(code >= 0x30 && code <= 0x39) /* ranges 0...9 */
+            input += (wchar_t)code;
+        break;
+    }
+}
+
+void calc_input::press_button(size_t index)
+{
+    if(index >= BUTTON_ROWS * BUTTON_COLUMNS)
+        return;
+    const wchar_t* label = BUTTON_LABELS[index / BUTTON_COLUMNS][index % BUTTON_COLUMNS];
+
+    if(std::wcscmp(label, NEGATE) == 0)
+        negate_number(input);
+    else if(std::wcscmp(label, CLEAR_ENTRY) == 0)
+        erase_final_number(input);
+    else if(std::wcscmp(label, CLEAR) == 0)
+        input.clear();
+    else if(std::wcscmp(label, BACKSPACE) == 0)
+    {
+        if(!input.empty())
+            input.pop_back();
+    }
+    else if(std::wcscmp(label, EQUALS) == 0)
+    {
+        try
+        {
+            answer = double2wstr(evaluator.evaluate(wstr2str(input)));
+            record(input, answer);
+            input = answer;
+        }
+        catch(std::exception& e)
+        {
+            error = e.what();
+        }
+    }
+    else
+    {
+        if(input.size() != 0 && input[0] == L'0')
+            input.erase(0, 1);
+        for(const wchar_t* c = label; *c != L'\0'; c++)
+            input += translate_glyph(*c);
+    }
+}
+
+bool calc_input::refresh(std::wstring& display)
+{
+    if(input == prev_input)
+        return false;
+    display = answer.empty() ? input : prev_input + L"=" + answer;
+    prev_input = input;
+    answer.clear();
+    return true;
+}
+
+bool calc_input::take_error(std::string& message)
+{
+    if(error.empty())
+        return false;
+    message.swap(error);
+    error.clear();
+    return true;
+}
+
+void calc_input::record(const std::wstring& expression, const std::wstring& result)
+{
+    if(history == nullptr)
+        return;
+    try
+    {
+        history->append(wstr2str(expression), wstr2str(result), (uint64_t)std::time(nullptr));
+    }
+    catch(std::exception& e)
+    {
+        error = e.what();
+    }
+}
+
+void calc_input::parse_input(const std::wstring& input, double& num1, double& num2, wchar_t& op)
+{
+    try
+    {
+        size_t pos = input.find_last_of(L"+-*/");
+        if(pos != std::wstring::npos)
+        {
+            num1 = std::stod(input.substr(0, pos));
+            std::wstring rest = input.substr(pos + 1);
+            num2 = rest.empty() ? num1 : std::stod(rest);
+            op = input[pos];
+        }
+        else
+            num1 = std::stod(input);
+    }
+    catch(std::exception& e)
+    {
+        error = e.what();
+    }
+}
+
+double calc_input::calculate_input(const std::wstring& input)
+{
+    double num1 = 0, num2 = 0, answer = 0;
+    wchar_t op = L'\0';
+    parse_input(input, num1, num2, op);
+
+    if(num1 != 0 && num2 != 0)
+    {
+        switch(op)
+        {
+        case L'+': answer = num1 + num2; break;
+        case L'-': answer = num1 - num2; break;
+        case L'*': answer = num1 * num2; break;
+        case L'/': answer = num1 / num2; break;
+        }
+    }
+    else
+        answer = num1;
+
+    return answer;
+}
+
+void calc_input::negate_number(std::wstring& input)
+{
+    if(input == L"0")
+        return;
+
+    double num1 = 0, num2 = 0;
+    wchar_t op = L'\0';
+    parse_input(input, num1, num2, op);
+
+    if(op == L'\0')
+        input = double2wstr(-num1); // Only one number is present
+    else
+        input = double2wstr(num1) + op + double2wstr(-num2);
+}
+
+void calc_input::erase_final_number(std::wstring& input)
+{
+    double num1 = 0, num2 = 0;
+    wchar_t op = L'\0';
+    parse_input(input, num1, num2, op);
+
+    if(op == L'\0')
+        input = L"0";
+    else
+        input = double2wstr(num1) + op;
+}
+
+void write_event(std::ostream& out, const input_event& ev)
+{
+    out << (ev.source == input_source::key ? "key " : "button ") << ev.code << ' ' << ev.time_us << '\n';
+}
+
+std::vector<input_event> read_session(std::istream& in)
+{
+    std::vector<input_event> events;
+    std::string line;
+    size_t number = 0;
+    while(std::getline(in, line))
+    {
+        number++;
+        if(line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields(line);
+        std::string source;
+        input_event ev;
+        if(!(fields >> source >> ev.code >> ev.time_us) || (source != "key" && source != "button"))
+            throw std::runtime_error("Malformed session event on line " + std::to_string(number));
+        ev.source = source == "key" ? input_source::key : input_source::button;
+        events.push_back(ev);
+    }
+    return events;
+}
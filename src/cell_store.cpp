@@ -0,0 +1,232 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "cell_store.hpp"
+#include "parallel_for.hpp"
+#include "program.hpp"
+#include <algorithm>
+
+// Topological levels smaller than this are not worth spawning threads for
+const size_t PARALLEL_LEVEL_MIN = 64;
+
+cell_store::cell_store(unsigned threads) : threads(resolve_threads(threads))
+{
+}
+
+size_t cell_store::find_or_add(const std::string& name)
+{
+    auto it = index.find(name);
+    if(it != index.end())
+        return it->second;
+
+    cell c;
+    c.name = name;
+    c.value = 0.0;
+    c.error = "Reference to undefined cell '" + name + "'";
+    c.defined = false;
+    c.dirty = false;
+    cells.push_back(c);
+    index[name] = cells.size() - 1;
+    return cells.size() - 1;
+}
+
+// Whether target is among the transitive dependencies of from
+bool cell_store::reaches(size_t from, size_t target) const
+{
+    std::vector<size_t> stack(1, from);
+    std::vector<bool> seen(cells.size(), false);
+    while(!stack.empty())
+    {
+        size_t id = stack.back();
+        stack.pop_back();
+        if(id == target)
+            return true;
+        if(seen[id])
+            continue;
+        seen[id] = true;
+        stack.insert(stack.end(), cells[id].refs.begin(), cells[id].refs.end());
+    }
+    return false;
+}
+
+void cell_store::set(const std::string& name, const std::string& formula)
+{
+    // infix_to_postfix does not check operand counts ("1/"), a throwaway
+    // compile rejects those here instead of on the first recompute
+    program::compile(formula, false);
+    std::vector<token> program = infix_to_postfix(formula);
+
+    std::vector<std::string> ref_names;
+    for(size_t i = 0; i < program.size(); i++)
+    {
+        if(program[i].type == token_type::variable)
+            ref_names.push_back(formula.substr(program[i].begin, program[i].length));
+    }
+
+    // Check for cycles before touching the store
+    auto self = index.find(name);
+    for(size_t i = 0; i < ref_names.size(); i++)
+    {
+        if(ref_names[i] == name)
+            throw std::runtime_error("Circular reference: '" + name + "' references itself");
+        auto it = index.find(ref_names[i]);
+        if(self != index.end() && it != index.end() && reaches(it->second, self->second))
+            throw std::runtime_error("Circular reference: '" + name + "' depends on '" + ref_names[i] + "' which depends on '" + name + "'");
+    }
+
+    size_t id = find_or_add(name);
+    std::vector<size_t> refs;
+    for(size_t i = 0; i < ref_names.size(); i++)
+        refs.push_back(find_or_add(ref_names[i]));
+
+    // Swap the reverse edges over to the new reference set
+    for(size_t i = 0; i < cells[id].refs.size(); i++)
+    {
+        std::vector<size_t>& deps = cells[cells[id].refs[i]].dependents;
+        deps.erase(std::remove(deps.begin(), deps.end(), id), deps.end());
+    }
+    for(size_t i = 0; i < refs.size(); i++)
+    {
+        std::vector<size_t>& deps = cells[refs[i]].dependents;
+        if(std::find(deps.begin(), deps.end(), id) == deps.end())
+            deps.push_back(id);
+    }
+
+    cell& c = cells[id];
+    c.formula = formula;
+    c.program = program;
+    c.refs = refs;
+    c.defined = true;
+    c.dirty = false; // Let mark_dirty walk the dependents
+    mark_dirty(id);
+}
+
+// Invariant: every transitive dependent of a dirty cell is dirty too, so
+// the walk can stop at cells that already are
+void cell_store::mark_dirty(size_t id)
+{
+    std::vector<size_t> stack(1, id);
+    while(!stack.empty())
+    {
+        size_t cur = stack.back();
+        stack.pop_back();
+        if(cells[cur].dirty)
+            continue;
+        cells[cur].dirty = true;
+        stack.insert(stack.end(), cells[cur].dependents.begin(), cells[cur].dependents.end());
+    }
+}
+
+void cell_store::compute(size_t id)
+{
+    cell& c = cells[id];
+    c.dirty = false;
+    c.error.clear();
+    if(!c.defined)
+    {
+        c.error = "Reference to undefined cell '" + c.name + "'";
+        return;
+    }
+
+    std::vector<double> args(c.refs.size());
+    for(size_t i = 0; i < c.refs.size(); i++)
+    {
+        const cell& ref = cells[c.refs[i]];
+        if(!ref.error.empty())
+        {
+            c.error = ref.defined ? "Reference to invalid cell '" + ref.name + "'" : ref.error;
+            return;
+        }
+        args[i] = ref.value;
+    }
+    try
+    {
+        c.value = evaluate(c.program, args);
+    }
+    catch(std::exception& e)
+    {
+        c.error = e.what();
+    }
+}
+
+size_t cell_store::recompute()
+{
+    // Kahn's algorithm restricted to the dirty cells
+    std::vector<size_t> pending(cells.size(), 0);
+    std::vector<size_t> level;
+    size_t dirty = 0;
+    for(size_t id = 0; id < cells.size(); id++)
+    {
+        if(!cells[id].dirty)
+            continue;
+        dirty++;
+        for(size_t i = 0; i < cells[id].refs.size(); i++)
+            pending[id] += cells[cells[id].refs[i]].dirty;
+        if(pending[id] == 0)
+            level.push_back(id);
+    }
+
+    while(!level.empty())
+    {
+        parallel_for(level.size(), level.size() < PARALLEL_LEVEL_MIN ? 1 : threads, [&](size_t i)
+        {
+            compute(level[i]);
+        });
+
+        std::vector<size_t> next;
+        for(size_t i = 0; i < level.size(); i++)
+        {
+            const std::vector<size_t>& deps = cells[level[i]].dependents;
+            for(size_t d = 0; d < deps.size(); d++)
+            {
+                // A formula may reference the same cell more than once
+                size_t uses = std::count(cells[deps[d]].refs.begin(), cells[deps[d]].refs.end(), level[i]);
+                pending[deps[d]] -= uses;
+                if(pending[deps[d]] == 0)
+                    next.push_back(deps[d]);
+            }
+        }
+        level.swap(next);
+    }
+    return dirty;
+}
+
+double cell_store::get(const std::string& name)
+{
+    auto it = index.find(name);
+    if(it == index.end())
+        throw std::runtime_error("Unknown cell '" + name + "'");
+    if(cells[it->second].dirty)
+        recompute();
+    const cell& c = cells[it->second];
+    if(!c.error.empty())
+        throw std::runtime_error(c.error);
+    return c.value;
+}
+
+bool cell_store::contains(const std::string& name) const
+{
+    auto it = index.find(name);
+    return it != index.end() && cells[it->second].defined;
+}
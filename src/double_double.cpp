@@ -0,0 +1,206 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "double_double.hpp"
+#include <stdexcept>
+
+static double_double power_of_ten(int e)
+{
+    double_double out(1.0), base(10.0);
+    for(unsigned n = (unsigned)std::abs(e); n != 0; n >>= 1)
+    {
+        if(n & 1)
+            out = dd_mul(out, base);
+        base = dd_mul(base, base);
+    }
+    return e < 0 ? dd_div(double_double(1.0), out) : out;
+}
+
+// Significant digits read into the value, a few past what double-double
+// holds. Later nonzero digits only set a sticky digit.
+const int LITERAL_DIGITS = 40;
+
+double_double double_double::from_literal(const std::string& text)
+{
+    double_double value;
+    int exponent = 0, significant = 0;
+    bool dec_pnt = false, digits = false, dropped = false;
+    for(size_t i = 0; i < text.size(); i++)
+    {
+        char c = text[i];
+        if(c == '.')
+        {
+            if(dec_pnt)
+                throw std::runtime_error("Invalid number format");
+            dec_pnt = true;
+            continue;
+        }
+        if(c < '0' || c > '9')
+            throw std::runtime_error("Invalid number format");
+        digits = true;
+        if(significant < LITERAL_DIGITS)
+        {
+            value = dd_add(dd_mul(value, double_double(10.0)), double_double((double)(c - '0')));
+            if(significant > 0 || c != '0')
+                significant++;
+            if(dec_pnt)
+                exponent--;
+        }
+        else
+        {
+            dropped = dropped || c != '0';
+            if(!dec_pnt)
+                exponent++;
+        }
+    }
+    if(!digits)
+        throw std::runtime_error("Invalid number format");
+    // A digit below everything kept, so a truncated literal never reads
+    // back as exactly its prefix
+    if(dropped)
+    {
+        value = dd_add(dd_mul(value, double_double(10.0)), double_double(1.0));
+        exponent--;
+    }
+
+    // Scale by 10^exponent in steps that stay finite, the value has at most
+    // LITERAL_DIGITS + 1 digits so only a truly out of range literal
+    // overflows or underflows
+    if(exponent < -250)
+    {
+        // Divide at 2^600 times the size, the low part would underflow
+        // and cost the high part its rounding otherwise
+        value = dd_mul(value, double_double(std::ldexp(1.0, 600)));
+        for(; exponent < -300; exponent += 300)
+            value = dd_div(value, power_of_ten(300));
+        value = dd_div(value, power_of_ten(-exponent));
+        return double_double(std::ldexp(value.hi, -600), std::ldexp(value.lo, -600));
+    }
+    if(exponent < 0)
+        return dd_div(value, power_of_ten(-exponent));
+    for(; exponent > 300; exponent -= 300)
+        value = dd_mul(value, power_of_ten(300));
+    return exponent == 0 ? value : dd_mul(value, power_of_ten(exponent));
+}
+
+std::string double_double::to_string() const
+{
+    if(std::isnan(hi))
+        return "nan";
+    if(std::isinf(hi))
+        return hi < 0 ? "-inf" : "inf";
+    if(hi == 0.0)
+        return std::signbit(hi) ? "-0" : "0";
+
+    // Double-double holds a little over 31 digits. Below 2^-969 the low
+    // part underflows and only the high part's 17 are meaningful.
+    double_double x = hi < 0 ? -*this : *this;
+    const int DIGITS = x.hi < 2.0041683600089728e-292 ? 17 : 31;
+    int e = (int)std::floor(std::log10(x.hi));
+    double_double r = e < -300 ? dd_div(dd_mul(x, power_of_ten(300)), power_of_ten(e + 300)) : dd_div(x, power_of_ten(e));
+    // Compare both parts, 1 - tiny has hi == 1 and would lead with a 0
+    if(!dd_less(r, double_double(10.0)))
+    {
+        e++;
+        r = dd_div(r, double_double(10.0));
+    }
+    else if(dd_less(r, double_double(1.0)))
+    {
+        e--;
+        r = dd_mul(r, double_double(10.0));
+    }
+
+    // Generate one extra digit for rounding
+    std::string digits;
+    for(int i = 0; i <= DIGITS; i++)
+    {
+        int d = (int)std::floor(r.hi);
+        if(d < 0)
+            d = 0;
+        if(d > 9)
+            d = 9;
+        digits += (char)('0' + d);
+        r = dd_mul(dd_add(r, double_double((double)-d)), double_double(10.0));
+        // Earlier digits can leave a slightly negative remainder
+        if(r.hi < 0 && i < DIGITS)
+        {
+            for(size_t k = digits.size(); k-- > 0;)
+            {
+                if(digits[k] != '0')
+                {
+                    digits[k]--;
+                    break;
+                }
+                digits[k] = '9';
+            }
+            r = dd_add(r, double_double(10.0));
+        }
+    }
+    // A borrow that reached the leading digit, shift the digits up
+    if(digits[0] == '0')
+    {
+        digits.erase(digits.begin());
+        digits += '0';
+        e--;
+    }
+    bool round_up = digits[DIGITS] >= '5';
+    digits.resize(DIGITS);
+    if(round_up)
+    {
+        int k = DIGITS - 1;
+        while(k >= 0 && digits[k] == '9')
+            digits[k--] = '0';
+        if(k >= 0)
+            digits[k]++;
+        else
+        {
+            digits.insert(digits.begin(), '1');
+            digits.pop_back();
+            e++;
+        }
+    }
+    while(digits.size() > 1 && digits.back() == '0')
+        digits.pop_back();
+
+    std::string out = hi < 0 ? "-" : "";
+    if(e >= 0 && e < DIGITS)
+    {
+        if((int)digits.size() <= e + 1)
+            out += digits + std::string(e + 1 - digits.size(), '0');
+        else
+            out += digits.substr(0, e + 1) + "." + digits.substr(e + 1);
+    }
+    else if(e < 0 && e >= -5)
+    {
+        out += "0." + std::string(-e - 1, '0') + digits;
+    }
+    else
+    {
+        out += digits.substr(0, 1);
+        if(digits.size() > 1)
+            out += "." + digits.substr(1);
+        out += (e < 0 ? "e-" : "e+") + std::to_string(std::abs(e));
+    }
+    return out;
+}
@@ -23,14 +23,16 @@ SOFTWARE.
 */
 
 #include "expr_eval.hpp"
+#include <cstdlib>
 #include <map>
+#include <sstream>
 #include <stack>
 
 token token_parser::get_next_token()
 {
+    skip_space();
     if(pos >= expr.length())
     return { token_type::end, 0.0 };
-    skip_space();
     char c = expr[pos++];
     switch(c)
     {
@@ -38,14 +40,37 @@ token token_parser::get_next_token()
     case '-': return { token_type::minus, 0.0 };
     case '*': return { token_type::multiply, 0.0 };
     case '/': return { token_type::divide, 0.0 };
+    case '<': return { match('=') ? token_type::less_equal : token_type::less, 0.0 };
+    case '>': return { match('=') ? token_type::greater_equal : token_type::greater, 0.0 };
+    case '!': return { match('=') ? token_type::not_equal : token_type::logical_not, 0.0 };
+    case '=':
+    if(!match('='))
+    throw std::runtime_error("Invalid character: '=', did you mean '=='?");
+    return { token_type::equal, 0.0 };
+    case '&':
+    if(!match('&'))
+    throw std::runtime_error("Invalid character: '&', did you mean '&&'?");
+    return { token_type::logical_and, 0.0 };
+    case '|':
+    if(!match('|'))
+    throw std::runtime_error("Invalid character: '|', did you mean '||'?");
+    return { token_type::logical_or, 0.0 };
+    case '?': return { token_type::question, 0.0 };
+    case ':': return { token_type::colon, 0.0 };
     case '(': return { token_type::lparen, 0.0 };
     case ')': return { token_type::rparen, 0.0 };
+    case '[': return { token_type::lbracket, 0.0 };
+    case ']': return { token_type::rbracket, 0.0 };
+    case ',': return { token_type::comma, 0.0 };
     default:
     {
     if(std::isdigit(c) || c == '.')
     {
     pos--;
     return get_number();
+    } else if(std::isalpha(c) || c == '_') {
+    pos--;
+    return get_identifier();
     } else {
     throw std::runtime_error("Invalid character: '"+std::string(1,c)+"'");
     }
@@ -53,16 +78,35 @@ token token_parser::get_next_token()
     }
 }
 
+bool token_parser::match(char c)
+{
+    if(pos < expr.length() && expr[pos] == c)
+    {
+    pos++;
+    return true;
+    }
+    return false;
+}
+
 void token_parser::skip_space()
 {
     for(;pos < expr.length() && std::isspace(expr[pos]); pos++)
     {}
 }
 
+token token_parser::get_identifier()
+{
+    size_t begin = pos;
+    while(pos < expr.length() && (std::isalnum(expr[pos]) || expr[pos] == '_'))
+    pos++;
+    return { token_type::variable, 0.0, begin, pos - begin };
+}
+
 token token_parser::get_number()
 {
     std::string num_str;
     bool dec_pnt = false;
+    size_t begin = pos;
 
     while(pos < expr.length() && (std::isdigit(expr[pos]) || expr[pos] == '.'))
     {
@@ -74,7 +118,12 @@ token token_parser::get_number()
     }
     num_str += expr[pos++];
     }
-    return { token_type::number, std::stod(num_str) };
+    if(num_str == ".")
+    throw std::runtime_error("Invalid number format");
+    // The exact modes re-read the digits from the span, the double value
+    // only serves floating mode and saturates to inf instead of throwing
+    // on literals past DBL_MAX
+    return { token_type::number, std::strtod(num_str.c_str(), nullptr), begin, num_str.length() };
 }
 
 struct op_properties
@@ -84,8 +133,18 @@ struct op_properties
     bool unary;
     bool binary;
 };
-std::map<token_type, op_properties> op_info =
+const std::map<token_type, op_properties> op_info =
 {
+    {token_type::question, {-4, false, false, true}},
+    {token_type::conditional, {-4, false, false, true}},
+    {token_type::logical_or, {-3, true, false, true}},
+    {token_type::logical_and, {-2, true, false, true}},
+    {token_type::equal, {-1, true, false, true}},
+    {token_type::not_equal, {-1, true, false, true}},
+    {token_type::less, {0, true, false, true}},
+    {token_type::less_equal, {0, true, false, true}},
+    {token_type::greater, {0, true, false, true}},
+    {token_type::greater_equal, {0, true, false, true}},
     {token_type::plus, {1, true, false, true}},
     {token_type::minus,{1, true, false, true}},
     {token_type::multiply, {2, true, false, true}},
@@ -93,8 +152,17 @@ std::map<token_type, op_properties> op_info =
     // 3 Reserved for power
     {token_type::unary_plus, {4, false, true, false}},
     {token_type::unary_minus, {4, false, true, false}},
+    {token_type::logical_not, {4, false, true, false}},
 };
 
+// Lookup without inserting, so concurrent parses never write to op_info
+static const op_properties& props(token_type type)
+{
+    static const op_properties none = {0, false, false, false};
+    auto it = op_info.find(type);
+    return it == op_info.end() ? none : it->second;
+}
+
 std::vector<token> infix_to_postfix(std::string infix)
 {
     std::vector<token> out;
@@ -102,12 +170,13 @@ std::vector<token> infix_to_postfix(std::string infix)
     bool first = true;
     bool after_open_paren = false;
     token_parser tp(infix);
-    token tk, ltk;
+    token tk, ltk = { token_type::end, 0.0, 0, 0 };
     while((tk = tp.get_next_token()).type != token_type::end)
     {
     switch(tk.type)
     {
     case token_type::number:
+    case token_type::variable:
     {
     out.push_back(tk);
     break;
@@ -121,6 +190,8 @@ std::vector<token> infix_to_postfix(std::string infix)
     {
         while (!operators.empty() && operators.top() != token_type::lparen)
         {
+            if(operators.top() == token_type::question)
+                throw std::runtime_error("Conditional mismatched, missing ':'");
             out.push_back({ operators.top(),0 });
             operators.pop();
         }
@@ -130,9 +201,28 @@ std::vector<token> infix_to_postfix(std::string infix)
         after_open_paren = true; // Avoid the confusion of the mechanism :))))
         break;
     }
+    case token_type::lbracket:
+    case token_type::rbracket:
+    case token_type::comma:
+        throw std::runtime_error("Vector literals are only supported in matrix expressions");
+    case token_type::colon:
+    {
+        // Close the pending '?', the pair becomes one three operand operator
+        while (!operators.empty() && operators.top() != token_type::question && operators.top() != token_type::lparen)
+        {
+            out.push_back({ operators.top(),0 });
+            operators.pop();
+        }
+        if(operators.empty() || operators.top() != token_type::question)
+            throw std::runtime_error("Conditional mismatched, missing '?'");
+        operators.pop();
+        operators.push(token_type::conditional);
+        after_open_paren = false;
+        break;
+    }
     default: // Unary operator handlimg may have bug potential
     {
-    if(op_info[tk.type].binary || op_info[tk.type].unary)
+    if(props(tk.type).binary || props(tk.type).unary)
     {
     token_type cop = tk.type;
     if(first)
@@ -149,14 +239,15 @@ std::vector<token> infix_to_postfix(std::string infix)
         cop = token_type::unary_minus;
         break;
         }
+        case token_type::logical_not: break;
         default:
         throw std::runtime_error("Unknown unary operator");
         }
     }
     else if(operators.size() > 0)
     {
-        if(!after_open_paren && ((op_info[operators.top()].binary || op_info[operators.top()].unary) || operators.top() == token_type::lparen) &&
-        /*!is_un(operators.top()) &&*/ ltk.type != token_type::number)
+        if(!after_open_paren && ((props(operators.top()).binary || props(operators.top()).unary) || operators.top() == token_type::lparen) &&
+        /*!is_un(operators.top()) &&*/ ltk.type != token_type::number && ltk.type != token_type::variable)
         {
         switch(cop)
         {
@@ -170,14 +261,17 @@ std::vector<token> infix_to_postfix(std::string infix)
         cop = token_type::unary_minus;
         break;
         }
+        case token_type::logical_not: break;
         default:
         throw std::runtime_error("Unknown unary operator");
         }
         }
+        else if(cop == token_type::logical_not)
+        throw std::runtime_error("Misplaced '!', expected an operator");
         while (!operators.empty() &&
-            (op_info[operators.top()].binary || op_info[operators.top()].unary) &&
-        ((op_info[cop].left_assoc && op_info[cop].precedence <= op_info[operators.top()].precedence) ||
-        (!op_info[cop].left_assoc && op_info[cop].precedence < op_info[operators.top()].precedence))
+            (props(operators.top()).binary || props(operators.top()).unary) &&
+        ((props(cop).left_assoc && props(cop).precedence <= props(operators.top()).precedence) ||
+        (!props(cop).left_assoc && props(cop).precedence < props(operators.top()).precedence))
         )
         {
             if (operators.empty())
@@ -186,6 +280,8 @@ std::vector<token> infix_to_postfix(std::string infix)
         operators.pop();
         }
     }
+    else if(cop == token_type::logical_not)
+    throw std::runtime_error("Misplaced '!', expected an operator");
     operators.push(cop);
     after_open_paren = false;
     }
@@ -200,12 +296,155 @@ std::vector<token> infix_to_postfix(std::string infix)
     {
     if(operators.top() == token_type::lparen)
     throw std::runtime_error("Parenthesis mismatched, missing close parenthesis");
+    if(operators.top() == token_type::question)
+    throw std::runtime_error("Conditional mismatched, missing ':'");
     out.push_back({operators.top(),0});
     operators.pop();
     }
     return out;
 }
 
+// Nesting deeper than this is left to the postfix path, which keeps its
+// stacks on the heap
+const int DIRECT_MAX_DEPTH = 256;
+
+struct direct_too_deep {};
+
+double apply_op(double a, double b, token_type op);
+
+// Precedence climbing straight over the token stream, each operator is
+// applied as soon as its right operand has been read
+class direct_evaluator
+{
+public:
+    direct_evaluator(const std::string& infix) : tp(infix), depth(0)
+    {
+        cur = tp.get_next_token();
+    }
+
+    double run()
+    {
+        if(cur.type == token_type::end)
+            throw std::runtime_error("Empty expression");
+        double value = parse_binary(props(token_type::conditional).precedence);
+        switch(cur.type)
+        {
+        case token_type::end: return value;
+        case token_type::rparen: throw std::runtime_error("Parenthesis mismatched, missing open parenthesis");
+        case token_type::colon: throw std::runtime_error("Conditional mismatched, missing '?'");
+        case token_type::logical_not: throw std::runtime_error("Misplaced '!', expected an operator");
+        case token_type::lbracket:
+        case token_type::rbracket:
+        case token_type::comma: throw std::runtime_error("Vector literals are only supported in matrix expressions");
+        default: throw std::runtime_error("Operator imbalance");
+        }
+    }
+
+private:
+    void advance()
+    {
+        cur = tp.get_next_token();
+    }
+
+    double parse_binary(int min_precedence)
+    {
+        if(++depth > DIRECT_MAX_DEPTH)
+            throw direct_too_deep();
+        double lhs = parse_unary();
+        for(;;)
+        {
+            token_type op = cur.type;
+            const op_properties& info = props(op == token_type::question ? token_type::conditional : op);
+            if(!info.binary || info.precedence < min_precedence)
+                break;
+            advance();
+            if(op == token_type::question)
+            {
+                double a = parse_binary(info.precedence);
+                if(cur.type != token_type::colon)
+                    throw std::runtime_error("Conditional mismatched, missing ':'");
+                advance();
+                double b = parse_binary(info.precedence);
+                lhs = lhs != 0 ? a : b;
+            }
+            else
+            {
+                double rhs = parse_binary(info.left_assoc ? info.precedence + 1 : info.precedence);
+                lhs = apply_op(lhs, rhs, op);
+            }
+        }
+        depth--;
+        return lhs;
+    }
+
+    double parse_unary()
+    {
+        token tk = cur;
+        switch(tk.type)
+        {
+        case token_type::number:
+            advance();
+            return tk.number;
+        case token_type::variable:
+            throw std::runtime_error("Unbound variable");
+        case token_type::plus:
+            advance();
+            return parse_operand();
+        case token_type::minus:
+            advance();
+            return parse_operand() * -1;
+        case token_type::logical_not:
+            advance();
+            return parse_operand() == 0;
+        case token_type::lparen:
+        {
+            advance();
+            double value = parse_binary(props(token_type::conditional).precedence);
+            if(cur.type != token_type::rparen)
+                throw std::runtime_error("Parenthesis mismatched, missing close parenthesis");
+            advance();
+            return value;
+        }
+        case token_type::lbracket:
+        case token_type::rbracket:
+        case token_type::comma:
+            throw std::runtime_error("Vector literals are only supported in matrix expressions");
+        case token_type::end:
+        case token_type::rparen:
+        case token_type::colon:
+            throw std::runtime_error("Operator imbalance");
+        default:
+            throw std::runtime_error("Unknown unary operator");
+        }
+    }
+
+    // Operand of a prefix operator, counted against the nesting limit
+    double parse_operand()
+    {
+        if(++depth > DIRECT_MAX_DEPTH)
+            throw direct_too_deep();
+        double value = parse_unary();
+        depth--;
+        return value;
+    }
+
+    token_parser tp;
+    token cur;
+    int depth;
+};
+
+double evaluate_direct(const std::string& infix)
+{
+    try
+    {
+        return direct_evaluator(infix).run();
+    }
+    catch(const direct_too_deep&)
+    {
+        return evaluate(infix_to_postfix(infix));
+    }
+}
+
 double apply_op(double a, double b, token_type op)
 {
     switch(op)
@@ -214,6 +453,15 @@ double apply_op(double a, double b, token_type op)
     case token_type::minus: return a-b;
     case token_type::multiply: return a*b;
     case token_type::divide: return a/b;
+    case token_type::less: return a < b;
+    case token_type::less_equal: return a <= b;
+    case token_type::greater: return a > b;
+    case token_type::greater_equal: return a >= b;
+    case token_type::equal: return a == b;
+    case token_type::not_equal: return a != b;
+    // Both sides are always evaluated, there is no short circuit
+    case token_type::logical_and: return (a != 0) & (b != 0);
+    case token_type::logical_or: return (a != 0) | (b != 0);
     default: return 0;
     }
     return 0.0;
@@ -221,11 +469,17 @@ double apply_op(double a, double b, token_type op)
 
 // No bug detected
 double evaluate(std::vector<token> tks)
+{
+    return evaluate(tks, std::vector<double>());
+}
+
+double evaluate(const std::vector<token>& tks, const std::vector<double>& variables)
 {
     std::stack<double> operands;
-    for(int i = 0; i < tks.size(); i++)
+    size_t next_variable = 0;
+    for(size_t i = 0; i < tks.size(); i++)
     {
-    token tk = tks[i];
+    const token& tk = tks[i];
     switch(tk.type)
     {
     case token_type::number:
@@ -233,10 +487,25 @@ double evaluate(std::vector<token> tks)
         operands.push(tk.number);
         break;
     }
+    case token_type::variable:
+    {
+        if(next_variable >= variables.size())
+        throw std::runtime_error("Unbound variable");
+        operands.push(variables[next_variable++]);
+        break;
+    }
     case token_type::plus:
     case token_type::minus:
     case token_type::multiply:
     case token_type::divide:
+    case token_type::less:
+    case token_type::less_equal:
+    case token_type::greater:
+    case token_type::greater_equal:
+    case token_type::equal:
+    case token_type::not_equal:
+    case token_type::logical_and:
+    case token_type::logical_or:
     {
         if(operands.size() < 2)
         throw std::runtime_error("Operator imbalance");
@@ -251,14 +520,211 @@ double evaluate(std::vector<token> tks)
     case token_type::unary_plus: break; // Nothing to do
     case token_type::unary_minus:
     {
+        if(operands.empty())
+        throw std::runtime_error("Operator imbalance");
         double apply = operands.top() * -1;
         operands.pop();
         operands.push(apply);
         break;
     }
+    case token_type::logical_not:
+    {
+        if(operands.empty())
+        throw std::runtime_error("Operator imbalance");
+        operands.top() = operands.top() == 0;
+        break;
+    }
+    case token_type::conditional:
+    {
+        if(operands.size() < 3)
+        throw std::runtime_error("Operator imbalance");
+
+        double b = operands.top();
+        operands.pop();
+        double a = operands.top();
+        operands.pop();
+        operands.top() = operands.top() != 0 ? a : b;
+        break;
+    }
     default:
         throw std::runtime_error("Internal error");
     }
     }
+    if(operands.empty())
+    throw std::runtime_error("Empty expression");
     return operands.top();
-}
\ No newline at end of file
+}
+
+// Comparison and logical operators. In double-double mode they give the
+// same results as run_batch_dd, nonzero hi parts count as true.
+static bool apply_logic(const double_double& a, const double_double& b, token_type op)
+{
+    switch(op)
+    {
+    case token_type::less: return dd_less(a, b);
+    case token_type::less_equal: return !dd_less(b, a);
+    case token_type::greater: return dd_less(b, a);
+    case token_type::greater_equal: return !dd_less(a, b);
+    case token_type::equal: return dd_equal(a, b);
+    case token_type::not_equal: return !dd_equal(a, b);
+    case token_type::logical_and: return a.hi != 0 && b.hi != 0;
+    default: return a.hi != 0 || b.hi != 0;
+    }
+}
+
+static bool is_true(const double_double& value)
+{
+    return value.hi != 0;
+}
+
+// Exact modes (big_int, rational) compare exactly, nonzero is true
+template<typename T>
+static bool apply_logic(const T& a, const T& b, token_type op)
+{
+    switch(op)
+    {
+    case token_type::less: return a < b;
+    case token_type::less_equal: return a <= b;
+    case token_type::greater: return a > b;
+    case token_type::greater_equal: return a >= b;
+    case token_type::equal: return a == b;
+    case token_type::not_equal: return a != b;
+    case token_type::logical_and: return !a.is_zero() && !b.is_zero();
+    default: return !a.is_zero() || !b.is_zero();
+    }
+}
+
+template<typename T>
+static bool is_true(const T& value)
+{
+    return !value.is_zero();
+}
+
+template<typename T, typename literal_parser>
+T evaluate_with(const std::vector<token>& tks, const std::string& infix, literal_parser parse)
+{
+    std::stack<T> operands;
+    for(size_t i = 0; i < tks.size(); i++)
+    {
+    const token& tk = tks[i];
+    switch(tk.type)
+    {
+    case token_type::number:
+    {
+        operands.push(parse(infix.substr(tk.begin, tk.length)));
+        break;
+    }
+    case token_type::plus:
+    case token_type::minus:
+    case token_type::multiply:
+    case token_type::divide:
+    {
+        if(operands.size() < 2)
+        throw std::runtime_error("Operator imbalance");
+
+        T b = std::move(operands.top());
+        operands.pop();
+        T& a = operands.top();
+        switch(tk.type)
+        {
+        case token_type::plus: a += b; break;
+        case token_type::minus: a -= b; break;
+        case token_type::multiply: a *= b; break;
+        default: a /= b; break;
+        }
+        break;
+    }
+    case token_type::less:
+    case token_type::less_equal:
+    case token_type::greater:
+    case token_type::greater_equal:
+    case token_type::equal:
+    case token_type::not_equal:
+    case token_type::logical_and:
+    case token_type::logical_or:
+    {
+        if(operands.size() < 2)
+        throw std::runtime_error("Operator imbalance");
+
+        T b = std::move(operands.top());
+        operands.pop();
+        operands.top() = T(apply_logic(operands.top(), b, tk.type) ? 1 : 0);
+        break;
+    }
+    case token_type::unary_plus: break; // Nothing to do
+    case token_type::unary_minus:
+    {
+        if(operands.empty())
+        throw std::runtime_error("Operator imbalance");
+        operands.top() = -operands.top();
+        break;
+    }
+    case token_type::logical_not:
+    {
+        if(operands.empty())
+        throw std::runtime_error("Operator imbalance");
+        operands.top() = T(is_true(operands.top()) ? 0 : 1);
+        break;
+    }
+    case token_type::conditional:
+    {
+        if(operands.size() < 3)
+        throw std::runtime_error("Operator imbalance");
+
+        T b = std::move(operands.top());
+        operands.pop();
+        T a = std::move(operands.top());
+        operands.pop();
+        operands.top() = is_true(operands.top()) ? std::move(a) : std::move(b);
+        break;
+    }
+    default:
+        throw std::runtime_error("Operator not supported in this mode");
+    }
+    }
+    if(operands.empty())
+    throw std::runtime_error("Empty expression");
+    return operands.top();
+}
+
+big_int evaluate_integer(const std::vector<token>& tks, const std::string& infix)
+{
+    return evaluate_with<big_int>(tks, infix, [](const std::string& literal)
+    {
+        if(literal.find('.') != std::string::npos)
+        throw std::runtime_error("Decimal number in integer mode: " + literal);
+        return big_int::from_string(literal);
+    });
+}
+
+rational evaluate_rational(const std::vector<token>& tks, const std::string& infix)
+{
+    rational out = evaluate_with<rational>(tks, infix, rational::from_literal);
+    out.normalize();
+    return out;
+}
+
+double_double evaluate_double_double(const std::vector<token>& tks, const std::string& infix)
+{
+    return evaluate_with<double_double>(tks, infix, double_double::from_literal);
+}
+
+std::string format_result(double value)
+{
+    std::ostringstream ss;
+    ss.precision(15);
+    ss << value;
+    return ss.str();
+}
+
+std::string evaluate(const std::string& infix, eval_mode mode)
+{
+    std::vector<token> tks = infix_to_postfix(infix);
+    switch(mode)
+    {
+    case eval_mode::integer: return evaluate_integer(tks, infix).to_string();
+    case eval_mode::rational: return evaluate_rational(tks, infix).to_string();
+    case eval_mode::double_double: return evaluate_double_double(tks, infix).to_string();
+    default: return format_result(evaluate(tks));
+    }
+}
@@ -0,0 +1,151 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "gradient.hpp"
+#include "program_kernels.hpp"
+#include <algorithm>
+#include <cstring>
+
+// Rows per block, each stack slot holds (1 + wrt_count) lanes of this size
+const size_t GRADIENT_BLOCK = 128;
+
+void run_batch_gradient(const program_view& p, const double* const* columns,
+                        const uint32_t* wrt, size_t wrt_count,
+                        double* values, double* const* gradients, size_t rows)
+{
+    const size_t B = GRADIENT_BLOCK;
+    const size_t lanes = 1 + wrt_count;
+    const size_t slot_size = lanes * B; // Value lane followed by the tangent lanes
+    std::vector<double> regs((size_t)p.max_stack * slot_size);
+
+    for(size_t row = 0; row < rows; row += B)
+    {
+        size_t n = std::min(B, rows - row);
+        size_t sp = 0;
+        for(uint32_t i = 0; i < p.code_size; i++)
+        {
+            const instruction& ins = p.code[i];
+            double* r = regs.data() + sp * slot_size;
+            double* a = r - 2 * slot_size;
+            double* b = r - slot_size;
+            switch(ins.op)
+            {
+            case opcode::push_const:
+            {
+                double c = p.constants[ins.operand];
+                for(size_t k = 0; k < n; k++) r[k] = c;
+                std::fill(r + B, r + slot_size, 0.0);
+                sp++;
+                break;
+            }
+            case opcode::load_var:
+            {
+                const double* col = columns[ins.operand] + row;
+                for(size_t k = 0; k < n; k++) r[k] = col[k];
+                for(size_t j = 0; j < wrt_count; j++)
+                    std::fill(r + (1 + j) * B, r + (2 + j) * B, wrt[j] == ins.operand ? 1.0 : 0.0);
+                sp++;
+                break;
+            }
+            case opcode::add:
+                for(size_t l = 0; l < lanes; l++)
+                    for(size_t k = 0; k < n; k++) a[l * B + k] += b[l * B + k];
+                sp--;
+                break;
+            case opcode::sub:
+                for(size_t l = 0; l < lanes; l++)
+                    for(size_t k = 0; k < n; k++) a[l * B + k] -= b[l * B + k];
+                sp--;
+                break;
+            case opcode::mul:
+                // (a, a') * (b, b') = (ab, a'b + ab'), tangents first while a is intact
+                for(size_t l = 1; l < lanes; l++)
+                    for(size_t k = 0; k < n; k++) a[l * B + k] = a[l * B + k] * b[k] + a[k] * b[l * B + k];
+                for(size_t k = 0; k < n; k++) a[k] *= b[k];
+                sp--;
+                break;
+            case opcode::div:
+                // (a, a') / (b, b') = (a/b, (a' - (a/b) b') / b)
+                for(size_t k = 0; k < n; k++) a[k] /= b[k];
+                for(size_t l = 1; l < lanes; l++)
+                    for(size_t k = 0; k < n; k++) a[l * B + k] = (a[l * B + k] - a[k] * b[l * B + k]) / b[k];
+                sp--;
+                break;
+            case opcode::neg:
+                for(size_t l = 0; l < lanes; l++)
+                    for(size_t k = 0; k < n; k++) b[l * B + k] *= -1;
+                break;
+            case opcode::lt: for(size_t k = 0; k < n; k++) a[k] = a[k] < b[k]; std::fill(a + B, a + slot_size, 0.0); sp--; break;
+            case opcode::le: for(size_t k = 0; k < n; k++) a[k] = a[k] <= b[k]; std::fill(a + B, a + slot_size, 0.0); sp--; break;
+            case opcode::gt: for(size_t k = 0; k < n; k++) a[k] = a[k] > b[k]; std::fill(a + B, a + slot_size, 0.0); sp--; break;
+            case opcode::ge: for(size_t k = 0; k < n; k++) a[k] = a[k] >= b[k]; std::fill(a + B, a + slot_size, 0.0); sp--; break;
+            case opcode::eq: for(size_t k = 0; k < n; k++) a[k] = a[k] == b[k]; std::fill(a + B, a + slot_size, 0.0); sp--; break;
+            case opcode::ne: for(size_t k = 0; k < n; k++) a[k] = a[k] != b[k]; std::fill(a + B, a + slot_size, 0.0); sp--; break;
+            case opcode::land: for(size_t k = 0; k < n; k++) a[k] = (a[k] != 0) & (b[k] != 0); std::fill(a + B, a + slot_size, 0.0); sp--; break;
+            case opcode::lor: for(size_t k = 0; k < n; k++) a[k] = (a[k] != 0) | (b[k] != 0); std::fill(a + B, a + slot_size, 0.0); sp--; break;
+            case opcode::lnot: for(size_t k = 0; k < n; k++) b[k] = b[k] == 0; std::fill(b + B, b + slot_size, 0.0); break;
+            case opcode::select:
+            {
+                // The condition lane picks value and tangents of the same side
+                double* c = r - 3 * slot_size;
+                for(size_t l = 1; l < lanes; l++)
+                    for(size_t k = 0; k < n; k++) c[l * B + k] = select_bits(c[k], a[l * B + k], b[l * B + k]);
+                for(size_t k = 0; k < n; k++) c[k] = select_bits(c[k], a[k], b[k]);
+                sp -= 2;
+                break;
+            }
+            // Flattened chains: the error slot only corrects the value, its
+            // tangent lanes stay zero
+            case opcode::sum_begin:
+            case opcode::prod_begin: std::fill(r, r + slot_size, 0.0); sp++; break;
+            case opcode::sum_add:
+            {
+                double* s = r - 3 * slot_size; // Running sum, a holds its error and b the term
+                for(size_t l = 1; l < lanes; l++)
+                    for(size_t k = 0; k < n; k++) s[l * B + k] += b[l * B + k];
+                for(size_t k = 0; k < n; k++) sum_step(s[k], a[k], b[k]);
+                sp--;
+                break;
+            }
+            case opcode::prod_mul:
+            {
+                double* s = r - 3 * slot_size;
+                for(size_t l = 1; l < lanes; l++)
+                    for(size_t k = 0; k < n; k++) s[l * B + k] = s[l * B + k] * b[k] + (s[k] + a[k]) * b[l * B + k];
+                for(size_t k = 0; k < n; k++) prod_step(s[k], a[k], b[k]);
+                sp--;
+                break;
+            }
+            case opcode::sum_end:
+            case opcode::prod_end:
+                for(size_t k = 0; k < n; k++) a[k] = add_error(a[k], b[k]);
+                sp--;
+                break;
+            }
+        }
+        for(size_t k = 0; k < n; k++) values[row + k] = regs[k];
+        for(size_t j = 0; j < wrt_count; j++)
+            std::memcpy(gradients[j] + row, regs.data() + (1 + j) * B, n * sizeof(double));
+    }
+}
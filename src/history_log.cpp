@@ -0,0 +1,181 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "history_log.hpp"
+#include <cstring>
+#include <stdexcept>
+
+static const char HISTORY_MAGIC[8] = { 'W', '3', '2', 'C', 'H', 'I', 'S', '\0' };
+
+// Room for this many entries and log bytes when a history is created
+const size_t HISTORY_INITIAL_ENTRIES = 4096;
+const uint64_t HISTORY_INITIAL_BYTES = 256 * 1024;
+
+struct history_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t count;
+    uint64_t log_size;
+};
+
+struct history_entry
+{
+    uint64_t offset;
+    uint32_t expression_length;
+    uint32_t result_length;
+    uint64_t time;
+    uint64_t key; // Expression prefix, zero padded
+};
+
+static uint64_t prefix_key(const char* s, size_t length)
+{
+    uint64_t key = 0;
+    std::memcpy(&key, s, length < sizeof(key) ? length : sizeof(key));
+    return key;
+}
+
+// Selects the first n bytes of a key in memory order, whatever the endianness
+static uint64_t prefix_mask(size_t n)
+{
+    unsigned char bytes[8] = {};
+    std::memset(bytes, 0xFF, n < sizeof(bytes) ? n : sizeof(bytes));
+    uint64_t mask;
+    std::memcpy(&mask, bytes, sizeof(mask));
+    return mask;
+}
+
+history_log::history_log(const std::string& path) : path(path), lock(path + ".lock")
+{
+    index = mapped_file::open_writable(path + ".idx", sizeof(history_header) + HISTORY_INITIAL_ENTRIES * sizeof(history_entry));
+    log = mapped_file::open_writable(path, HISTORY_INITIAL_BYTES);
+
+    history_header* h = (history_header*)index.writable_data();
+    if(h->version == 0)
+    {
+        // Freshly created, the new bytes are all zero
+        std::memcpy(h->magic, HISTORY_MAGIC, sizeof(h->magic));
+        h->version = HISTORY_VERSION;
+        h->entry_size = sizeof(history_entry);
+    }
+    if(std::memcmp(h->magic, HISTORY_MAGIC, sizeof(h->magic)) != 0)
+        throw std::runtime_error("Not a history index: '" + path + ".idx'");
+    if(h->version != HISTORY_VERSION || h->entry_size != sizeof(history_entry))
+        throw std::runtime_error("Unsupported history version " + std::to_string(h->version));
+    if(h->count > (index.size() - sizeof(history_header)) / sizeof(history_entry) || h->log_size > log.size())
+        throw std::runtime_error("Corrupt history: '" + path + "'");
+}
+
+size_t history_log::size() const
+{
+    return (size_t)((const history_header*)index.data())->count;
+}
+
+void history_log::reserve(size_t entries, uint64_t bytes)
+{
+    size_t index_needed = sizeof(history_header) + entries * sizeof(history_entry);
+    if(index_needed > index.size())
+    {
+        size_t grown = sizeof(history_header) + 2 * (index.size() - sizeof(history_header));
+        // Unmap first, Windows cannot extend a file that has a view open
+        index.close();
+        index = mapped_file::open_writable(path + ".idx", index_needed > grown ? index_needed : grown);
+    }
+    if(bytes > log.size())
+    {
+        uint64_t grown = 2 * (uint64_t)log.size();
+        log.close();
+        log = mapped_file::open_writable(path, (size_t)(bytes > grown ? bytes : grown));
+    }
+}
+
+void history_log::append(const std::string& expression, const std::string& result, uint64_t time)
+{
+    if(expression.size() > UINT32_MAX || result.size() > UINT32_MAX)
+        throw std::runtime_error("History record too large");
+    const history_header* h = (const history_header*)index.data();
+    reserve((size_t)h->count + 1, h->log_size + expression.size() + result.size());
+
+    history_header* header = (history_header*)index.writable_data();
+    unsigned char* bytes = log.writable_data();
+    history_entry e;
+    e.offset = header->log_size;
+    e.expression_length = (uint32_t)expression.size();
+    e.result_length = (uint32_t)result.size();
+    e.time = time;
+    e.key = prefix_key(expression.data(), expression.size());
+    std::memcpy(bytes + e.offset, expression.data(), expression.size());
+    std::memcpy(bytes + e.offset + expression.size(), result.data(), result.size());
+    std::memcpy(index.writable_data() + sizeof(history_header) + header->count * sizeof(history_entry), &e, sizeof(e));
+
+    // Publish last, a reader of the count always finds its record complete
+    header->log_size = e.offset + expression.size() + result.size();
+    header->count++;
+}
+
+history_record history_log::get(size_t i) const
+{
+    const history_header* h = (const history_header*)index.data();
+    if(i >= h->count)
+        throw std::runtime_error("History record out of range");
+    const history_entry* e = (const history_entry*)(index.data() + sizeof(history_header)) + i;
+    if(e->offset + e->expression_length + e->result_length > h->log_size)
+        throw std::runtime_error("Corrupt history: '" + path + "'");
+
+    const char* text = (const char*)log.data() + e->offset;
+    history_record out;
+    out.expression.assign(text, e->expression_length);
+    out.result.assign(text + e->expression_length, e->result_length);
+    out.time = e->time;
+    return out;
+}
+
+std::vector<size_t> history_log::search_prefix(const std::string& prefix, size_t limit) const
+{
+    std::vector<size_t> out;
+    const history_header* h = (const history_header*)index.data();
+    const history_entry* entries = (const history_entry*)(index.data() + sizeof(history_header));
+    uint64_t key = prefix_key(prefix.data(), prefix.size()), mask = prefix_mask(prefix.size());
+    for(size_t i = (size_t)h->count; i-- > 0 && out.size() < limit;)
+    {
+        const history_entry& e = entries[i];
+        if((e.key & mask) != key || e.expression_length < prefix.size())
+            continue;
+        if(prefix.size() > sizeof(e.key))
+        {
+            if(e.offset + e.expression_length > h->log_size ||
+               std::memcmp(log.data() + e.offset + sizeof(e.key), prefix.data() + sizeof(e.key), prefix.size() - sizeof(e.key)) != 0)
+                continue;
+        }
+        out.push_back(i);
+    }
+    return out;
+}
+
+void history_log::flush()
+{
+    log.flush();
+    index.flush();
+}
@@ -0,0 +1,230 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "mapped_file.hpp"
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+mapped_file::mapped_file(const std::string& path) : base(nullptr), length(0), handle(nullptr), writable(false)
+{
+#if defined(_WIN32)
+    // FILE_SHARE_DELETE lets a writer replace the file while it is mapped
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Cannot open '" + path + "'");
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Cannot stat '" + path + "'");
+    }
+    length = (size_t)size.QuadPart;
+    if(length != 0)
+    {
+        handle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(handle != nullptr)
+            base = (const unsigned char*)MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+    }
+    CloseHandle(file);
+    if(length != 0 && base == nullptr)
+    {
+        close();
+        throw std::runtime_error("Cannot map '" + path + "'");
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        throw std::runtime_error("Cannot open '" + path + "'");
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat '" + path + "'");
+    }
+    length = (size_t)st.st_size;
+    if(length != 0)
+    {
+        void* p = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        if(p != MAP_FAILED)
+            base = (const unsigned char*)p;
+    }
+    ::close(fd);
+    if(length != 0 && base == nullptr)
+        throw std::runtime_error("Cannot map '" + path + "'");
+#endif
+}
+
+mapped_file mapped_file::open_writable(const std::string& path, size_t min_size)
+{
+    mapped_file out;
+    out.writable = true;
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Cannot open '" + path + "'");
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Cannot stat '" + path + "'");
+    }
+    // A mapping larger than the file extends it
+    out.length = (size_t)size.QuadPart < min_size ? min_size : (size_t)size.QuadPart;
+    if(out.length != 0)
+    {
+        out.handle = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((uint64_t)out.length >> 32), (DWORD)out.length, NULL);
+        if(out.handle != nullptr)
+            out.base = (const unsigned char*)MapViewOfFile(out.handle, FILE_MAP_WRITE, 0, 0, 0);
+    }
+    CloseHandle(file);
+    if(out.length != 0 && out.base == nullptr)
+        throw std::runtime_error("Cannot map '" + path + "'");
+#else
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0)
+        throw std::runtime_error("Cannot open '" + path + "'");
+    struct stat st;
+    if(fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat '" + path + "'");
+    }
+    out.length = (size_t)st.st_size < min_size ? min_size : (size_t)st.st_size;
+    if((size_t)st.st_size < out.length && ftruncate(fd, (off_t)out.length) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Cannot grow '" + path + "'");
+    }
+    if(out.length != 0)
+    {
+        void* p = mmap(nullptr, out.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if(p != MAP_FAILED)
+            out.base = (const unsigned char*)p;
+    }
+    ::close(fd);
+    if(out.length != 0 && out.base == nullptr)
+    {
+        out.length = 0;
+        throw std::runtime_error("Cannot map '" + path + "'");
+    }
+#endif
+    return out;
+}
+
+mapped_file::~mapped_file()
+{
+    close();
+}
+
+mapped_file::mapped_file(mapped_file&& other) : base(other.base), length(other.length), handle(other.handle), writable(other.writable)
+{
+    other.base = nullptr;
+    other.length = 0;
+    other.handle = nullptr;
+    other.writable = false;
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other)
+{
+    if(this != &other)
+    {
+        close();
+        std::swap(base, other.base);
+        std::swap(length, other.length);
+        std::swap(handle, other.handle);
+        std::swap(writable, other.writable);
+    }
+    return *this;
+}
+
+void mapped_file::flush()
+{
+    if(base == nullptr || !writable)
+        return;
+#if defined(_WIN32)
+    FlushViewOfFile(base, 0);
+#else
+    msync((void*)base, length, MS_SYNC);
+#endif
+}
+
+void mapped_file::close()
+{
+#if defined(_WIN32)
+    if(base != nullptr)
+        UnmapViewOfFile(base);
+    if(handle != nullptr)
+        CloseHandle((HANDLE)handle);
+#else
+    if(base != nullptr)
+        munmap((void*)base, length);
+#endif
+    base = nullptr;
+    length = 0;
+    handle = nullptr;
+    writable = false;
+}
+
+file_lock::file_lock(const std::string& path)
+{
+#if defined(_WIN32)
+    // No sharing at all, a second open fails with a sharing violation
+    handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(handle == INVALID_HANDLE_VALUE)
+    {
+        if(GetLastError() == ERROR_SHARING_VIOLATION)
+            throw std::runtime_error("'" + path + "' is locked by another writer");
+        throw std::runtime_error("Cannot open '" + path + "'");
+    }
+#else
+    fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if(fd < 0)
+        throw std::runtime_error("Cannot open '" + path + "'");
+    if(flock(fd, LOCK_EX | LOCK_NB) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("'" + path + "' is locked by another writer");
+    }
+#endif
+}
+
+file_lock::~file_lock()
+{
+#if defined(_WIN32)
+    CloseHandle((HANDLE)handle);
+#else
+    ::close(fd);
+#endif
+}
@@ -0,0 +1,396 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "matrix_expr.hpp"
+#include <algorithm>
+#include <cstring>
+
+const int MATRIX_MAX_DEPTH = 256;
+
+std::string value_shape::to_string() const
+{
+    switch(kind)
+    {
+    case value_kind::scalar: return "scalar";
+    case value_kind::vector: return "vector[" + std::to_string(rows) + "]";
+    default: return "matrix[" + std::to_string(rows) + "x" + std::to_string(cols) + "]";
+    }
+}
+
+typedef matrix_program::operand operand;
+typedef matrix_program::step step;
+typedef matrix_program::step_op step_op;
+
+// Recursive descent with precedence climbing, emitting steps in
+// evaluation order while it checks shapes
+class matrix_compiler
+{
+public:
+    matrix_compiler(const std::string& infix, const std::vector<matrix_variable>& variables,
+                    std::vector<step>& steps, std::vector<operand>& gathered, std::vector<double>& arena) :
+        tp(infix), source(infix), variables(variables), steps(steps), gathered(gathered), arena(arena), depth(0)
+    {
+        cur = tp.get_next_token();
+    }
+
+    operand compile()
+    {
+        if(cur.type == token_type::end)
+            throw std::runtime_error("Empty expression");
+        operand out = parse_binary(1);
+        if(cur.type == token_type::rparen)
+            throw std::runtime_error("Parenthesis mismatched, missing open parenthesis");
+        if(cur.type == token_type::rbracket)
+            throw std::runtime_error("Bracket mismatched, missing '['");
+        if(cur.type != token_type::end)
+            throw std::runtime_error("Operator not supported in matrix expressions");
+        return out;
+    }
+
+private:
+    void advance()
+    {
+        cur = tp.get_next_token();
+    }
+
+    operand allocate(const value_shape& shape)
+    {
+        operand out = { false, (uint32_t)arena.size(), shape };
+        arena.resize(arena.size() + shape.size(), 0.0);
+        return out;
+    }
+
+    operand emit(step_op op, const value_shape& shape, const operand& a, const operand& b)
+    {
+        step s = { op, allocate(shape), a, b, 0, 0 };
+        steps.push_back(s);
+        return s.out;
+    }
+
+    static int precedence(token_type type)
+    {
+        switch(type)
+        {
+        case token_type::plus:
+        case token_type::minus: return 1;
+        case token_type::multiply:
+        case token_type::divide: return 2;
+        default: return 0;
+        }
+    }
+
+    operand parse_binary(int min_precedence)
+    {
+        if(++depth > MATRIX_MAX_DEPTH)
+            throw std::runtime_error("Expression nested too deeply");
+        operand lhs = parse_unary();
+        for(;;)
+        {
+            token_type op = cur.type;
+            int p = precedence(op);
+            if(p == 0 || p < min_precedence)
+                break;
+            advance();
+            operand rhs = parse_binary(p + 1);
+            lhs = combine(op, lhs, rhs);
+        }
+        depth--;
+        return lhs;
+    }
+
+    operand combine(token_type op, const operand& a, const operand& b)
+    {
+        const value_shape& x = a.shape;
+        const value_shape& y = b.shape;
+        bool xs = x.kind == value_kind::scalar, ys = y.kind == value_kind::scalar;
+        switch(op)
+        {
+        case token_type::plus:
+        case token_type::minus:
+            if(!xs && !ys && (x.kind != y.kind || x.rows != y.rows || x.cols != y.cols))
+                break;
+            return emit(op == token_type::plus ? step_op::add : step_op::sub, xs ? y : x, a, b);
+        case token_type::multiply:
+            if(xs || ys)
+                return emit(step_op::mul, xs ? y : x, a, b);
+            if(x.kind == value_kind::matrix && y.kind == value_kind::matrix && x.cols == y.rows)
+                return emit(step_op::matmul, value_shape::matrix(x.rows, y.cols), a, b);
+            if(x.kind == value_kind::matrix && y.kind == value_kind::vector && x.cols == y.rows)
+                return emit(step_op::matvec, value_shape::vector(x.rows), a, b);
+            if(x.kind == value_kind::vector && y.kind == value_kind::matrix && x.rows == y.rows)
+                return emit(step_op::vecmat, value_shape::vector(y.cols), a, b);
+            break;
+        default:
+            if(ys)
+                return emit(step_op::div, x, a, b);
+            break;
+        }
+        static const char* names[] = { "+", "-", "*", "/" };
+        const char* name = names[op == token_type::plus ? 0 : op == token_type::minus ? 1 : op == token_type::multiply ? 2 : 3];
+        throw std::runtime_error("Shape mismatch: " + x.to_string() + " " + name + " " + y.to_string());
+    }
+
+    // A run of signs is read in a loop, an odd number of minuses is one
+    // negation
+    operand parse_unary()
+    {
+        bool negate = false;
+        for(; cur.type == token_type::plus || cur.type == token_type::minus; advance())
+            negate ^= cur.type == token_type::minus;
+        operand a = parse_primary();
+        return negate ? emit(step_op::neg, a.shape, a, a) : a;
+    }
+
+    operand parse_primary()
+    {
+        switch(cur.type)
+        {
+        case token_type::number:
+        {
+            operand out = allocate(value_shape::scalar());
+            arena[out.index] = cur.number;
+            advance();
+            return out;
+        }
+        case token_type::variable:
+        {
+            std::string name = source.substr(cur.begin, cur.length);
+            advance();
+            for(size_t i = 0; i < variables.size(); i++)
+            {
+                if(variables[i].name == name)
+                    return { true, (uint32_t)i, variables[i].shape };
+            }
+            throw std::runtime_error("Unknown variable '" + name + "'");
+        }
+        case token_type::lparen:
+        {
+            advance();
+            operand out = parse_binary(1);
+            if(cur.type != token_type::rparen)
+                throw std::runtime_error("Parenthesis mismatched, missing close parenthesis");
+            advance();
+            return out;
+        }
+        case token_type::lbracket:
+            return parse_literal();
+        default:
+            throw std::runtime_error("Operator imbalance");
+        }
+    }
+
+    // [a, b, ...] of scalars is a vector, of equal length vectors a matrix
+    operand parse_literal()
+    {
+        advance();
+        std::vector<operand> elements;
+        for(;;)
+        {
+            elements.push_back(parse_binary(1));
+            if(cur.type == token_type::rbracket)
+                break;
+            if(cur.type != token_type::comma)
+                throw std::runtime_error("Bracket mismatched, missing ']'");
+            advance();
+        }
+        advance();
+
+        const value_shape& first = elements[0].shape;
+        value_shape shape;
+        if(first.kind == value_kind::scalar)
+            shape = value_shape::vector((uint32_t)elements.size());
+        else if(first.kind == value_kind::vector)
+            shape = value_shape::matrix((uint32_t)elements.size(), first.rows);
+        else
+            throw std::runtime_error("Matrix literal rows must be vectors, got " + first.to_string());
+        for(size_t i = 1; i < elements.size(); i++)
+        {
+            if(elements[i].shape.kind != first.kind || elements[i].shape.rows != first.rows)
+                throw std::runtime_error("Literal elements differ in shape: " + first.to_string() + " and " + elements[i].shape.to_string());
+        }
+
+        operand out = allocate(shape);
+        // Constant elements are copied in now, the rest at run time
+        bool constant = true;
+        for(size_t i = 0; i < elements.size() && constant; i++)
+            constant = !elements[i].variable && !written_by_step(elements[i]);
+        if(constant)
+        {
+            for(size_t i = 0; i < elements.size(); i++)
+                std::copy(arena.begin() + elements[i].index, arena.begin() + elements[i].index + first.size(),
+                          arena.begin() + out.index + i * first.size());
+            return out;
+        }
+        step s = { step_op::gather, out, out, out, (uint32_t)gathered.size(), (uint32_t)elements.size() };
+        gathered.insert(gathered.end(), elements.begin(), elements.end());
+        steps.push_back(s);
+        return out;
+    }
+
+    bool written_by_step(const operand& o) const
+    {
+        for(size_t i = steps.size(); i-- > 0;)
+        {
+            if(steps[i].out.index == o.index)
+                return true;
+        }
+        return false;
+    }
+
+    token_parser tp;
+    std::string source; // Variable names, tokens only carry spans
+    token cur;
+    const std::vector<matrix_variable>& variables;
+    std::vector<step>& steps;
+    std::vector<operand>& gathered;
+    std::vector<double>& arena;
+    int depth;
+};
+
+matrix_program matrix_program::compile(const std::string& infix, const std::vector<matrix_variable>& variables)
+{
+    matrix_program out;
+    matrix_compiler compiler(infix, variables, out.steps, out.gathered, out.arena);
+    out.result = compiler.compile();
+    out.shape = out.result.shape;
+    return out;
+}
+
+// C += A * B for row-major A (n x k), B (k x m), C (n x m). Tiled so each
+// block of B stays in cache while a block of rows of A streams past it;
+// the inner loop runs along contiguous rows of B and C and vectorizes.
+static void matmul_kernel(const double* a, const double* b, double* c, size_t n, size_t k, size_t m)
+{
+    for(size_t i0 = 0; i0 < n; i0 += MATMUL_BLOCK)
+    {
+        size_t i1 = std::min(n, i0 + MATMUL_BLOCK);
+        for(size_t k0 = 0; k0 < k; k0 += MATMUL_BLOCK)
+        {
+            size_t k1 = std::min(k, k0 + MATMUL_BLOCK);
+            for(size_t j0 = 0; j0 < m; j0 += MATMUL_BLOCK)
+            {
+                size_t j1 = std::min(m, j0 + MATMUL_BLOCK);
+                for(size_t i = i0; i < i1; i++)
+                {
+                    double* crow = c + i * m;
+                    for(size_t p = k0; p < k1; p++)
+                    {
+                        double x = a[i * k + p];
+                        const double* brow = b + p * m;
+                        for(size_t j = j0; j < j1; j++)
+                            crow[j] += x * brow[j];
+                    }
+                }
+            }
+        }
+    }
+}
+
+// y = A x, four partial sums per row break the add dependency chain
+static void matvec_kernel(const double* a, const double* x, double* y, size_t n, size_t k)
+{
+    for(size_t i = 0; i < n; i++)
+    {
+        const double* row = a + i * k;
+        double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        size_t p = 0;
+        for(; p + 4 <= k; p += 4)
+        {
+            s0 += row[p] * x[p];
+            s1 += row[p + 1] * x[p + 1];
+            s2 += row[p + 2] * x[p + 2];
+            s3 += row[p + 3] * x[p + 3];
+        }
+        for(; p < k; p++)
+            s0 += row[p] * x[p];
+        y[i] = (s0 + s1) + (s2 + s3);
+    }
+}
+
+void matrix_program::run(const double* const* variables, double* out)
+{
+    double* base = arena.data();
+    auto data = [&](const operand& o) -> const double*
+    {
+        return o.variable ? variables[o.index] : base + o.index;
+    };
+
+    for(size_t s = 0; s < steps.size(); s++)
+    {
+        const step& st = steps[s];
+        double* r = base + st.out.index;
+        const double* a = data(st.a);
+        const double* b = data(st.b);
+        size_t n = st.out.shape.size();
+        bool as = st.a.shape.kind == value_kind::scalar, bs = st.b.shape.kind == value_kind::scalar;
+        switch(st.op)
+        {
+        case step_op::add:
+            if(as && !bs) { double x = a[0]; for(size_t i = 0; i < n; i++) r[i] = x + b[i]; }
+            else if(bs) { double y = b[0]; for(size_t i = 0; i < n; i++) r[i] = a[i] + y; }
+            else for(size_t i = 0; i < n; i++) r[i] = a[i] + b[i];
+            break;
+        case step_op::sub:
+            if(as && !bs) { double x = a[0]; for(size_t i = 0; i < n; i++) r[i] = x - b[i]; }
+            else if(bs) { double y = b[0]; for(size_t i = 0; i < n; i++) r[i] = a[i] - y; }
+            else for(size_t i = 0; i < n; i++) r[i] = a[i] - b[i];
+            break;
+        case step_op::mul:
+            // One side is a scalar
+            if(as && !bs) { double x = a[0]; for(size_t i = 0; i < n; i++) r[i] = x * b[i]; }
+            else { double y = b[0]; for(size_t i = 0; i < n; i++) r[i] = a[i] * y; }
+            break;
+        case step_op::div:
+        {
+            double y = b[0];
+            for(size_t i = 0; i < n; i++) r[i] = a[i] / y;
+            break;
+        }
+        case step_op::neg:
+            for(size_t i = 0; i < n; i++) r[i] = -a[i];
+            break;
+        case step_op::matmul:
+            std::fill(r, r + n, 0.0);
+            matmul_kernel(a, b, r, st.a.shape.rows, st.a.shape.cols, st.b.shape.cols);
+            break;
+        case step_op::matvec:
+            matvec_kernel(a, b, r, st.a.shape.rows, st.a.shape.cols);
+            break;
+        case step_op::vecmat:
+            // x^T B is a 1 x k by k x m product
+            std::fill(r, r + n, 0.0);
+            matmul_kernel(a, b, r, 1, st.a.shape.rows, st.b.shape.cols);
+            break;
+        case step_op::gather:
+            for(uint32_t i = 0; i < st.count; i++)
+            {
+                const operand& e = gathered[st.first + i];
+                size_t len = e.shape.size();
+                std::memcpy(r + i * len, data(e), len * sizeof(double));
+            }
+            break;
+        }
+    }
+    std::memcpy(out, data(result), shape.size() * sizeof(double));
+}
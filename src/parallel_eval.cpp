@@ -0,0 +1,320 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "parallel_eval.hpp"
+#include "parallel_for.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+struct scan_chunk
+{
+    size_t begin, end;
+    long long delta;     // Parenthesis depth change across the chunk
+    long long lowest;    // Lowest depth reached, relative to the chunk start
+    long long start;     // Absolute depth at the chunk start
+    std::vector<size_t> add_ops, mul_ops; // Top-level binary operators
+    size_t top_level;    // Top-level non-space characters
+    bool lower_ops;      // Top-level comparison, logical or conditional operators
+};
+
+// '+' and '-' are binary only when they follow an operand
+static bool is_binary_sign(const std::string& src, size_t begin, size_t pos)
+{
+    while(pos > begin)
+    {
+        char c = src[--pos];
+        if(std::isspace((unsigned char)c))
+            continue;
+        return std::isalnum((unsigned char)c) || c == '_' || c == '.' || c == ')';
+    }
+    return false;
+}
+
+// Operands of the lowest-precedence top-level operator in [begin, end)
+struct split_result
+{
+    std::vector<size_t> bounds; // Operand i spans [bounds[i] + (i > 0), bounds[i + 1])
+    std::vector<char> ops;      // ops[i] joins operand i - 1 and operand i
+    bool wrapped;               // Whole span is one parenthesised group
+};
+
+static split_result split_top_level(const std::string& src, size_t begin, size_t end, unsigned threads)
+{
+    size_t length = end - begin;
+    std::vector<scan_chunk> chunks(threads);
+    for(size_t i = 0; i < chunks.size(); i++)
+    {
+        chunks[i].begin = begin + length * i / chunks.size();
+        chunks[i].end = begin + length * (i + 1) / chunks.size();
+    }
+
+    // Up-sweep: depth delta and lowest point of every chunk
+    parallel_for(chunks.size(), threads, [&](size_t i)
+    {
+        scan_chunk& ch = chunks[i];
+        long long depth = 0, lowest = 0;
+        for(size_t p = ch.begin; p < ch.end; p++)
+        {
+            if(src[p] == '(')
+                depth++;
+            else if(src[p] == ')')
+                lowest = std::min(lowest, --depth);
+        }
+        ch.delta = depth;
+        ch.lowest = lowest;
+    });
+
+    // Exclusive scan over the chunk totals
+    long long depth = 0;
+    for(size_t i = 0; i < chunks.size(); i++)
+    {
+        chunks[i].start = depth;
+        if(depth + chunks[i].lowest < 0)
+            throw std::runtime_error("Parenthesis mismatched, missing open parenthesis");
+        depth += chunks[i].delta;
+    }
+    if(depth != 0)
+        throw std::runtime_error("Parenthesis mismatched, missing close parenthesis");
+
+    // Down-sweep: with absolute depths known, collect the top-level operators
+    parallel_for(chunks.size(), threads, [&](size_t i)
+    {
+        scan_chunk& ch = chunks[i];
+        long long d = ch.start;
+        ch.top_level = 0;
+        ch.lower_ops = false;
+        for(size_t p = ch.begin; p < ch.end; p++)
+        {
+            char c = src[p];
+            if(c == ')')
+                d--;
+            if(d == 0 && !std::isspace((unsigned char)c))
+            {
+                ch.top_level++;
+                if((c == '+' || c == '-') && is_binary_sign(src, begin, p))
+                    ch.add_ops.push_back(p);
+                else if(c == '*' || c == '/')
+                    ch.mul_ops.push_back(p);
+                else if(std::strchr("<>=&|?:", c) != nullptr)
+                    ch.lower_ops = true;
+            }
+            if(c == '(')
+                d++;
+        }
+    });
+
+    bool has_add = false, has_lower = false;
+    size_t top_level = 0;
+    for(size_t i = 0; i < chunks.size(); i++)
+    {
+        has_add = has_add || !chunks[i].add_ops.empty();
+        has_lower = has_lower || chunks[i].lower_ops;
+        top_level += chunks[i].top_level;
+    }
+
+    split_result out;
+    out.bounds.push_back(begin);
+    out.ops.push_back(0);
+    // Operators binding looser than '+' are not split, leave those to the
+    // sequential engine
+    for(size_t i = 0; i < chunks.size() && !has_lower; i++)
+    {
+        const std::vector<size_t>& ops = has_add ? chunks[i].add_ops : chunks[i].mul_ops;
+        for(size_t p = 0; p < ops.size(); p++)
+        {
+            out.bounds.push_back(ops[p]);
+            out.ops.push_back(src[ops[p]]);
+        }
+    }
+    out.bounds.push_back(end);
+
+    // "( ... )" with nothing else at the top level
+    size_t first = begin, last = end;
+    while(first < last && std::isspace((unsigned char)src[first]))
+        first++;
+    while(last > first && std::isspace((unsigned char)src[last - 1]))
+        last--;
+    out.wrapped = out.ops.size() == 1 && top_level == 2 && src[first] == '(' && src[last - 1] == ')';
+    return out;
+}
+
+template<typename T>
+static T fold_left(const std::vector<T>& values, const std::vector<char>& ops)
+{
+    T acc = values[0];
+    for(size_t i = 1; i < values.size(); i++)
+    {
+        switch(ops[i])
+        {
+        case '+': acc += values[i]; break;
+        case '-': acc -= values[i]; break;
+        case '*': acc *= values[i]; break;
+        default: acc /= values[i]; break;
+        }
+    }
+    return acc;
+}
+
+// Pairwise reduction, only valid for associative combines
+template<typename T>
+static T tree_reduce(std::vector<T>& values, bool multiply, unsigned threads)
+{
+    for(size_t stride = 1; stride < values.size(); stride *= 2)
+    {
+        size_t pairs = (values.size() + 2 * stride - 1) / (2 * stride);
+        parallel_for(pairs, threads, [&](size_t p)
+        {
+            size_t i = p * 2 * stride;
+            if(i + stride >= values.size())
+                return;
+            if(multiply)
+                values[i] *= values[i + stride];
+            else
+                values[i] += values[i + stride];
+        });
+    }
+    return values[0];
+}
+
+// Floating point is not associative, fold in source order so every
+// rounding step matches the sequential engine
+static double combine(std::vector<double>& values, const std::vector<char>& ops, unsigned)
+{
+    return fold_left(values, ops);
+}
+
+// Double-double rounds too, same left fold
+static double_double combine(std::vector<double_double>& values, const std::vector<char>& ops, unsigned)
+{
+    return fold_left(values, ops);
+}
+
+static big_int combine(std::vector<big_int>& values, const std::vector<char>& ops, unsigned threads)
+{
+    // Truncating division does not reassociate with multiplication
+    if(std::find(ops.begin(), ops.end(), '/') != ops.end())
+        return fold_left(values, ops);
+    for(size_t i = 1; i < values.size(); i++)
+    {
+        if(ops[i] == '-')
+            values[i] = -values[i];
+    }
+    return tree_reduce(values, ops.size() > 1 && ops[1] == '*', threads);
+}
+
+static rational combine(std::vector<rational>& values, const std::vector<char>& ops, unsigned threads)
+{
+    for(size_t i = 1; i < values.size(); i++)
+    {
+        if(ops[i] == '-')
+            values[i] = -values[i];
+        else if(ops[i] == '/')
+            values[i] = rational(1) / values[i];
+    }
+    bool multiply = ops.size() > 1 && (ops[1] == '*' || ops[1] == '/');
+    rational out = tree_reduce(values, multiply, threads);
+    out.normalize();
+    return out;
+}
+
+static void evaluate_sequential(const std::string& expr, double& out)
+{
+    out = evaluate(infix_to_postfix(expr));
+}
+
+static void evaluate_sequential(const std::string& expr, double_double& out)
+{
+    out = evaluate_double_double(infix_to_postfix(expr), expr);
+}
+
+static void evaluate_sequential(const std::string& expr, big_int& out)
+{
+    out = evaluate_integer(infix_to_postfix(expr), expr);
+}
+
+static void evaluate_sequential(const std::string& expr, rational& out)
+{
+    out = evaluate_rational(infix_to_postfix(expr), expr);
+}
+
+template<typename T>
+static T evaluate_span(const std::string& src, size_t begin, size_t end, unsigned threads)
+{
+    T out;
+    if(end - begin < PARALLEL_MIN_LENGTH || threads <= 1)
+    {
+        evaluate_sequential(src.substr(begin, end - begin), out);
+        return out;
+    }
+
+    split_result split = split_top_level(src, begin, end, threads);
+    if(split.wrapped)
+    {
+        size_t open = src.find('(', begin), close = src.rfind(')', end - 1);
+        return evaluate_span<T>(src, open + 1, close, threads);
+    }
+    if(split.ops.size() == 1)
+    {
+        evaluate_sequential(src.substr(begin, end - begin), out);
+        return out;
+    }
+
+    size_t count = split.ops.size();
+    std::vector<T> values(count);
+    std::vector<size_t> large;
+    parallel_for(count, threads, [&](size_t i)
+    {
+        size_t b = split.bounds[i] + (i > 0), e = split.bounds[i + 1];
+        if(b == e || std::all_of(src.begin() + b, src.begin() + e, [](char c) { return std::isspace((unsigned char)c) != 0; }))
+            throw std::runtime_error("Operator imbalance");
+        if(e - b < PARALLEL_MIN_LENGTH)
+            evaluate_sequential(src.substr(b, e - b), values[i]);
+    });
+    // Operands that are themselves huge get the whole pool, one at a time
+    for(size_t i = 0; i < count; i++)
+    {
+        size_t b = split.bounds[i] + (i > 0), e = split.bounds[i + 1];
+        if(e - b >= PARALLEL_MIN_LENGTH)
+            values[i] = evaluate_span<T>(src, b, e, threads);
+    }
+    return combine(values, split.ops, threads);
+}
+
+double evaluate_parallel(const std::string& infix, unsigned threads)
+{
+    return evaluate_span<double>(infix, 0, infix.size(), resolve_threads(threads));
+}
+
+std::string evaluate_parallel(const std::string& infix, eval_mode mode, unsigned threads)
+{
+    threads = resolve_threads(threads);
+    switch(mode)
+    {
+    case eval_mode::integer: return evaluate_span<big_int>(infix, 0, infix.size(), threads).to_string();
+    case eval_mode::rational: return evaluate_span<rational>(infix, 0, infix.size(), threads).to_string();
+    case eval_mode::double_double: return evaluate_span<double_double>(infix, 0, infix.size(), threads).to_string();
+    default: return format_result(evaluate_span<double>(infix, 0, infix.size(), threads));
+    }
+}
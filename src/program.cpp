@@ -0,0 +1,627 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "program.hpp"
+#include "program_kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+// Programs this shallow run on a stack array instead of the heap
+const uint32_t LOCAL_STACK = 64;
+// Rows per block in run_batch
+const size_t BATCH_BLOCK = 256;
+
+static opcode binary_opcode(token_type type)
+{
+    switch(type)
+    {
+    case token_type::plus: return opcode::add;
+    case token_type::minus: return opcode::sub;
+    case token_type::multiply: return opcode::mul;
+    case token_type::divide: return opcode::div;
+    case token_type::less: return opcode::lt;
+    case token_type::less_equal: return opcode::le;
+    case token_type::greater: return opcode::gt;
+    case token_type::greater_equal: return opcode::ge;
+    case token_type::equal: return opcode::eq;
+    case token_type::not_equal: return opcode::ne;
+    case token_type::logical_and: return opcode::land;
+    default: return opcode::lor;
+    }
+}
+
+uint64_t hash_source(const std::string& source)
+{
+    uint64_t h = 14695981039346656037ULL;
+    for(size_t i = 0; i < source.size(); i++)
+    {
+        h ^= (unsigned char)source[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Expression tree rebuilt from the postfix, so chains can be flattened
+struct expr_node
+{
+    token_type type;
+    instruction leaf;   // push_const or load_var for operands
+    uint32_t child[3];
+};
+
+static bool in_chain(token_type type, bool product)
+{
+    return product ? type == token_type::multiply : type == token_type::plus || type == token_type::minus;
+}
+
+// Operands of the '+'/'-' or '*' chain rooted at root, left to right, each
+// with whether it is subtracted. Iterative, chains can be very deep.
+static void collect_terms(const std::vector<expr_node>& nodes, uint32_t root, std::vector<std::pair<uint32_t, bool>>& terms)
+{
+    bool product = nodes[root].type == token_type::multiply;
+    std::vector<std::pair<uint32_t, bool>> pending(1, std::make_pair(root, false));
+    while(!pending.empty())
+    {
+        std::pair<uint32_t, bool> cur = pending.back();
+        pending.pop_back();
+        const expr_node& node = nodes[cur.first];
+        if(in_chain(node.type, product))
+        {
+            pending.push_back(std::make_pair(node.child[1], cur.second != (node.type == token_type::minus)));
+            pending.push_back(std::make_pair(node.child[0], cur.second));
+        }
+        else
+            terms.push_back(cur);
+    }
+}
+
+// Values an instruction pops and pushes, false for unknown opcodes
+static bool stack_effect(opcode op, uint32_t& pops, uint32_t& pushes)
+{
+    pops = 0;
+    pushes = 1;
+    switch(op)
+    {
+    case opcode::push_const:
+    case opcode::load_var:
+        pops = 0;
+        return true;
+    case opcode::add:
+    case opcode::sub:
+    case opcode::mul:
+    case opcode::div:
+    case opcode::lt:
+    case opcode::le:
+    case opcode::gt:
+    case opcode::ge:
+    case opcode::eq:
+    case opcode::ne:
+    case opcode::land:
+    case opcode::lor:
+    case opcode::sum_end:
+    case opcode::prod_end:
+        pops = 2;
+        return true;
+    case opcode::neg:
+    case opcode::lnot:
+        pops = 1;
+        return true;
+    case opcode::select:
+        pops = 3;
+        return true;
+    case opcode::sum_begin:
+    case opcode::prod_begin:
+        pops = 1;
+        pushes = 2;
+        return true;
+    case opcode::sum_add:
+    case opcode::prod_mul:
+        pops = 3;
+        pushes = 2;
+        return true;
+    default:
+        return false;
+    }
+}
+
+program program::compile(const std::string& infix, bool flatten)
+{
+    std::vector<token> tks = infix_to_postfix(infix);
+
+    program out;
+    out.src = infix;
+    out.source_hash = hash_source(infix);
+    out.max_stack = 0;
+
+    std::map<std::pair<uint64_t, uint64_t>, uint32_t> pool;
+    std::map<std::string, uint32_t> slots;
+    std::vector<expr_node> nodes;
+    std::vector<uint32_t> stack;
+    nodes.reserve(tks.size());
+    for(size_t i = 0; i < tks.size(); i++)
+    {
+        const token& tk = tks[i];
+        expr_node node = { tk.type, { opcode::add, 0 }, { 0, 0, 0 } };
+        uint32_t arity = 0;
+        switch(tk.type)
+        {
+        case token_type::number:
+        {
+            // Keep what the literal loses to rounding, the double-double
+            // kernels add it back
+            std::string literal = infix.substr(tk.begin, tk.length);
+            double_double exact = double_double::from_literal(literal);
+            double tail = dd_add(exact, double_double(-tk.number)).hi;
+            // A nonzero literal that underflowed to zero, -0.0 adds nothing
+            // but tells it apart from an exact zero
+            if(tail == 0 && tk.number == 0 && literal.find_first_of("123456789") != std::string::npos)
+                tail = -0.0;
+            std::pair<uint64_t, uint64_t> key;
+            std::memcpy(&key.first, &tk.number, sizeof(key.first));
+            std::memcpy(&key.second, &tail, sizeof(key.second));
+            auto it = pool.find(key);
+            if(it == pool.end())
+            {
+                it = pool.insert(std::make_pair(key, (uint32_t)out.constants.size())).first;
+                out.constants.push_back(tk.number);
+                out.constants_lo.push_back(tail);
+            }
+            node.leaf = { opcode::push_const, it->second };
+            break;
+        }
+        case token_type::variable:
+        {
+            std::string name = infix.substr(tk.begin, tk.length);
+            auto it = slots.find(name);
+            if(it == slots.end())
+            {
+                it = slots.insert(std::make_pair(name, (uint32_t)out.variable_names.size())).first;
+                out.variable_names.push_back(name);
+            }
+            node.leaf = { opcode::load_var, it->second };
+            break;
+        }
+        case token_type::plus:
+        case token_type::minus:
+        case token_type::multiply:
+        case token_type::divide:
+        case token_type::less:
+        case token_type::less_equal:
+        case token_type::greater:
+        case token_type::greater_equal:
+        case token_type::equal:
+        case token_type::not_equal:
+        case token_type::logical_and:
+        case token_type::logical_or:
+            arity = 2;
+            break;
+        case token_type::conditional:
+            arity = 3;
+            break;
+        case token_type::unary_plus:
+            continue;
+        case token_type::unary_minus:
+        case token_type::logical_not:
+            arity = 1;
+            break;
+        default:
+            throw std::runtime_error("Internal error");
+        }
+        if(stack.size() < arity)
+            throw std::runtime_error("Operator imbalance");
+        for(uint32_t c = arity; c-- > 0;)
+        {
+            node.child[c] = stack.back();
+            stack.pop_back();
+        }
+        stack.push_back((uint32_t)nodes.size());
+        nodes.push_back(node);
+    }
+    if(stack.size() != 1)
+        throw std::runtime_error(stack.empty() ? "Empty expression" : "Operator imbalance");
+
+    // Emit postfix again, depth first. A step either expands a node or
+    // appends a finished instruction; steps are popped in reverse order.
+    struct emit_step
+    {
+        bool expand;
+        uint32_t node;
+        instruction ins;
+    };
+    std::vector<emit_step> steps;
+    std::vector<std::pair<uint32_t, bool>> terms;
+    steps.push_back({ true, stack[0], { opcode::add, 0 } });
+    while(!steps.empty())
+    {
+        emit_step step = steps.back();
+        steps.pop_back();
+        if(!step.expand)
+        {
+            out.code.push_back(step.ins);
+            continue;
+        }
+
+        const expr_node& node = nodes[step.node];
+        switch(node.type)
+        {
+        case token_type::number:
+        case token_type::variable:
+            out.code.push_back(node.leaf);
+            continue;
+        case token_type::plus:
+        case token_type::minus:
+        case token_type::multiply:
+        {
+            if(!flatten)
+                break;
+            terms.clear();
+            collect_terms(nodes, step.node, terms);
+            if(terms.size() < FLATTEN_MIN_TERMS)
+                break;
+            bool product = node.type == token_type::multiply;
+            steps.push_back({ false, 0, { product ? opcode::prod_end : opcode::sum_end, 0 } });
+            for(size_t t = terms.size(); t-- > 0;)
+            {
+                steps.push_back({ false, 0, { t == 0 ? (product ? opcode::prod_begin : opcode::sum_begin)
+                                                     : (product ? opcode::prod_mul : opcode::sum_add), 0 } });
+                if(terms[t].second)
+                    steps.push_back({ false, 0, { opcode::neg, 0 } });
+                steps.push_back({ true, terms[t].first, { opcode::add, 0 } });
+            }
+            continue;
+        }
+        default:
+            break;
+        }
+
+        instruction ins = { opcode::add, 0 };
+        uint32_t arity = 2;
+        switch(node.type)
+        {
+        case token_type::conditional: ins.op = opcode::select; arity = 3; break;
+        case token_type::unary_minus: ins.op = opcode::neg; arity = 1; break;
+        case token_type::logical_not: ins.op = opcode::lnot; arity = 1; break;
+        default: ins.op = binary_opcode(node.type); break;
+        }
+        steps.push_back({ false, 0, ins });
+        for(uint32_t c = arity; c-- > 0;)
+            steps.push_back({ true, node.child[c], { opcode::add, 0 } });
+    }
+
+    uint32_t depth = 0;
+    for(size_t i = 0; i < out.code.size(); i++)
+    {
+        uint32_t pops, pushes;
+        stack_effect(out.code[i].op, pops, pushes);
+        depth = depth - pops + pushes;
+        out.max_stack = std::max(out.max_stack, depth);
+    }
+
+    for(size_t i = 0; i < out.variable_names.size(); i++)
+    {
+        out.packed_names += out.variable_names[i];
+        out.packed_names += '\0';
+    }
+    return out;
+}
+
+program_view program::view() const
+{
+    program_view v;
+    v.code = code.data();
+    v.constants = constants.data();
+    v.constants_lo = constants_lo.data();
+    v.variable_names = packed_names.c_str();
+    v.code_size = (uint32_t)code.size();
+    v.constant_count = (uint32_t)constants.size();
+    v.variable_count = (uint32_t)variable_names.size();
+    v.max_stack = max_stack;
+    v.source_hash = source_hash;
+    return v;
+}
+
+bool find_variable(const program_view& p, const std::string& name, uint32_t& slot)
+{
+    const char* cur = p.variable_names;
+    for(uint32_t i = 0; i < p.variable_count; i++)
+    {
+        if(name == cur)
+        {
+            slot = i;
+            return true;
+        }
+        cur += std::strlen(cur) + 1;
+    }
+    return false;
+}
+
+void verify(const program_view& p)
+{
+    uint32_t depth = 0, deepest = 0;
+    for(uint32_t i = 0; i < p.code_size; i++)
+    {
+        const instruction& ins = p.code[i];
+        uint32_t pops, pushes;
+        if(!stack_effect(ins.op, pops, pushes))
+            throw std::runtime_error("Invalid program: unknown opcode");
+        if(ins.op == opcode::push_const && ins.operand >= p.constant_count)
+            throw std::runtime_error("Invalid program: constant out of range");
+        if(ins.op == opcode::load_var && ins.operand >= p.variable_count)
+            throw std::runtime_error("Invalid program: variable out of range");
+        if(depth < pops)
+            throw std::runtime_error("Invalid program: operator imbalance");
+        depth = depth - pops + pushes;
+        deepest = std::max(deepest, depth);
+    }
+    if(depth != 1 || deepest > p.max_stack)
+        throw std::runtime_error("Invalid program: operator imbalance");
+}
+
+double run(const program_view& p, const double* variables)
+{
+    // Only the result slot is cleared: verify() already rejects code that
+    // leaves no value, this keeps the compiler from flagging the read
+    double local[LOCAL_STACK];
+    local[0] = 0.0;
+    std::vector<double> heap;
+    double* stack = local;
+    if(p.max_stack > LOCAL_STACK)
+    {
+        heap.resize(p.max_stack);
+        stack = heap.data();
+    }
+
+    size_t sp = 0;
+    for(uint32_t i = 0; i < p.code_size; i++)
+    {
+        const instruction& ins = p.code[i];
+        switch(ins.op)
+        {
+        case opcode::push_const: stack[sp++] = p.constants[ins.operand]; break;
+        case opcode::load_var: stack[sp++] = variables[ins.operand]; break;
+        case opcode::add: sp--; stack[sp - 1] = stack[sp - 1] + stack[sp]; break;
+        case opcode::sub: sp--; stack[sp - 1] = stack[sp - 1] - stack[sp]; break;
+        case opcode::mul: sp--; stack[sp - 1] = stack[sp - 1] * stack[sp]; break;
+        case opcode::div: sp--; stack[sp - 1] = stack[sp - 1] / stack[sp]; break;
+        case opcode::neg: stack[sp - 1] = stack[sp - 1] * -1; break;
+        case opcode::lt: sp--; stack[sp - 1] = stack[sp - 1] < stack[sp]; break;
+        case opcode::le: sp--; stack[sp - 1] = stack[sp - 1] <= stack[sp]; break;
+        case opcode::gt: sp--; stack[sp - 1] = stack[sp - 1] > stack[sp]; break;
+        case opcode::ge: sp--; stack[sp - 1] = stack[sp - 1] >= stack[sp]; break;
+        case opcode::eq: sp--; stack[sp - 1] = stack[sp - 1] == stack[sp]; break;
+        case opcode::ne: sp--; stack[sp - 1] = stack[sp - 1] != stack[sp]; break;
+        case opcode::land: sp--; stack[sp - 1] = (stack[sp - 1] != 0) & (stack[sp] != 0); break;
+        case opcode::lor: sp--; stack[sp - 1] = (stack[sp - 1] != 0) | (stack[sp] != 0); break;
+        case opcode::lnot: stack[sp - 1] = stack[sp - 1] == 0; break;
+        case opcode::select: sp -= 2; stack[sp - 1] = select_bits(stack[sp - 1], stack[sp], stack[sp + 1]); break;
+        case opcode::sum_begin:
+        case opcode::prod_begin: stack[sp++] = 0.0; break;
+        case opcode::sum_add:
+        {
+            sp--;
+            sum_step(stack[sp - 2], stack[sp - 1], stack[sp]);
+            break;
+        }
+        case opcode::prod_mul:
+        {
+            sp--;
+            prod_step(stack[sp - 2], stack[sp - 1], stack[sp]);
+            break;
+        }
+        case opcode::sum_end:
+        case opcode::prod_end: sp--; stack[sp - 1] = add_error(stack[sp - 1], stack[sp]); break;
+        }
+    }
+    return stack[0];
+}
+
+void run_batch(const program_view& p, const double* const* columns, double* out, size_t rows)
+{
+    // One register of BATCH_BLOCK lanes per stack slot
+    std::vector<double> regs((size_t)p.max_stack * BATCH_BLOCK);
+    for(size_t row = 0; row < rows; row += BATCH_BLOCK)
+    {
+        size_t n = std::min(BATCH_BLOCK, rows - row);
+        size_t sp = 0;
+        for(uint32_t i = 0; i < p.code_size; i++)
+        {
+            const instruction& ins = p.code[i];
+            double* r = regs.data() + sp * BATCH_BLOCK;   // Slot a new value goes to
+            double* a = r - 2 * BATCH_BLOCK;               // Left operand of a binary op
+            double* b = r - BATCH_BLOCK;                   // Right operand, or the unary operand
+            switch(ins.op)
+            {
+            case opcode::push_const:
+            {
+                double c = p.constants[ins.operand];
+                for(size_t k = 0; k < n; k++) r[k] = c;
+                sp++;
+                break;
+            }
+            case opcode::load_var:
+            {
+                const double* col = columns[ins.operand] + row;
+                for(size_t k = 0; k < n; k++) r[k] = col[k];
+                sp++;
+                break;
+            }
+            case opcode::add: for(size_t k = 0; k < n; k++) a[k] = a[k] + b[k]; sp--; break;
+            case opcode::sub: for(size_t k = 0; k < n; k++) a[k] = a[k] - b[k]; sp--; break;
+            case opcode::mul: for(size_t k = 0; k < n; k++) a[k] = a[k] * b[k]; sp--; break;
+            case opcode::div: for(size_t k = 0; k < n; k++) a[k] = a[k] / b[k]; sp--; break;
+            case opcode::lt: for(size_t k = 0; k < n; k++) a[k] = a[k] < b[k]; sp--; break;
+            case opcode::le: for(size_t k = 0; k < n; k++) a[k] = a[k] <= b[k]; sp--; break;
+            case opcode::gt: for(size_t k = 0; k < n; k++) a[k] = a[k] > b[k]; sp--; break;
+            case opcode::ge: for(size_t k = 0; k < n; k++) a[k] = a[k] >= b[k]; sp--; break;
+            case opcode::eq: for(size_t k = 0; k < n; k++) a[k] = a[k] == b[k]; sp--; break;
+            case opcode::ne: for(size_t k = 0; k < n; k++) a[k] = a[k] != b[k]; sp--; break;
+            case opcode::land: for(size_t k = 0; k < n; k++) a[k] = (a[k] != 0) & (b[k] != 0); sp--; break;
+            case opcode::lor: for(size_t k = 0; k < n; k++) a[k] = (a[k] != 0) | (b[k] != 0); sp--; break;
+            case opcode::neg: for(size_t k = 0; k < n; k++) b[k] = b[k] * -1; break;
+            case opcode::lnot: for(size_t k = 0; k < n; k++) b[k] = b[k] == 0; break;
+            case opcode::select:
+            {
+                double* c = r - 3 * BATCH_BLOCK;
+                for(size_t k = 0; k < n; k++) c[k] = select_bits(c[k], a[k], b[k]);
+                sp -= 2;
+                break;
+            }
+            case opcode::sum_begin:
+            case opcode::prod_begin: std::fill(r, r + n, 0.0); sp++; break;
+            case opcode::sum_add:
+            {
+                // a is the running sum, b its error, r the incoming term
+                double* t = r - BATCH_BLOCK;
+                a = t - 2 * BATCH_BLOCK;
+                b = t - BATCH_BLOCK;
+                for(size_t k = 0; k < n; k++) sum_step(a[k], b[k], t[k]);
+                sp--;
+                break;
+            }
+            case opcode::prod_mul:
+            {
+                double* t = r - BATCH_BLOCK;
+                a = t - 2 * BATCH_BLOCK;
+                b = t - BATCH_BLOCK;
+                for(size_t k = 0; k < n; k++) prod_step(a[k], b[k], t[k]);
+                sp--;
+                break;
+            }
+            case opcode::sum_end:
+            case opcode::prod_end: for(size_t k = 0; k < n; k++) a[k] = add_error(a[k], b[k]); sp--; break;
+            }
+        }
+        for(size_t k = 0; k < n; k++) out[row + k] = regs[k];
+    }
+}
+
+void run_batch_dd(const program_view& p, const double* const* columns, double* out_hi, double* out_lo, size_t rows)
+{
+    // Each stack slot holds a block of hi lanes followed by a block of lo lanes
+    const size_t B = BATCH_BLOCK, slot_size = 2 * BATCH_BLOCK;
+    std::vector<double> regs((size_t)p.max_stack * slot_size);
+    for(size_t row = 0; row < rows; row += B)
+    {
+        size_t n = std::min(B, rows - row);
+        size_t sp = 0;
+        for(uint32_t i = 0; i < p.code_size; i++)
+        {
+            const instruction& ins = p.code[i];
+            double* r = regs.data() + sp * slot_size;
+            double* a = r - 2 * slot_size;
+            double* b = r - slot_size;
+            double* alo = a + B;
+            double* blo = b + B;
+            switch(ins.op)
+            {
+            case opcode::push_const:
+            {
+                double hi = p.constants[ins.operand], lo = p.constants_lo[ins.operand];
+                for(size_t k = 0; k < n; k++) { r[k] = hi; r[B + k] = lo; }
+                sp++;
+                break;
+            }
+            case opcode::load_var:
+            {
+                const double* col = columns[ins.operand] + row;
+                for(size_t k = 0; k < n; k++) { r[k] = col[k]; r[B + k] = 0.0; }
+                sp++;
+                break;
+            }
+            case opcode::add:
+            case opcode::sub:
+            case opcode::mul:
+            case opcode::div:
+            {
+                for(size_t k = 0; k < n; k++)
+                {
+                    double_double x(a[k], alo[k]), y(b[k], blo[k]);
+                    switch(ins.op)
+                    {
+                    case opcode::add: x = dd_add(x, y); break;
+                    case opcode::sub: x = dd_add(x, -y); break;
+                    case opcode::mul: x = dd_mul(x, y); break;
+                    default: x = dd_div(x, y); break;
+                    }
+                    a[k] = x.hi;
+                    alo[k] = x.lo;
+                }
+                sp--;
+                break;
+            }
+            case opcode::neg:
+                for(size_t k = 0; k < n; k++) { b[k] = -b[k]; blo[k] = -blo[k]; }
+                break;
+            case opcode::lt: for(size_t k = 0; k < n; k++) { a[k] = dd_less(double_double(a[k], alo[k]), double_double(b[k], blo[k])); alo[k] = 0.0; } sp--; break;
+            case opcode::le: for(size_t k = 0; k < n; k++) { a[k] = !dd_less(double_double(b[k], blo[k]), double_double(a[k], alo[k])); alo[k] = 0.0; } sp--; break;
+            case opcode::gt: for(size_t k = 0; k < n; k++) { a[k] = dd_less(double_double(b[k], blo[k]), double_double(a[k], alo[k])); alo[k] = 0.0; } sp--; break;
+            case opcode::ge: for(size_t k = 0; k < n; k++) { a[k] = !dd_less(double_double(a[k], alo[k]), double_double(b[k], blo[k])); alo[k] = 0.0; } sp--; break;
+            case opcode::eq: for(size_t k = 0; k < n; k++) { a[k] = dd_equal(double_double(a[k], alo[k]), double_double(b[k], blo[k])); alo[k] = 0.0; } sp--; break;
+            case opcode::ne: for(size_t k = 0; k < n; k++) { a[k] = !dd_equal(double_double(a[k], alo[k]), double_double(b[k], blo[k])); alo[k] = 0.0; } sp--; break;
+            case opcode::land: for(size_t k = 0; k < n; k++) { a[k] = (a[k] != 0) & (b[k] != 0); alo[k] = 0.0; } sp--; break;
+            case opcode::lor: for(size_t k = 0; k < n; k++) { a[k] = (a[k] != 0) | (b[k] != 0); alo[k] = 0.0; } sp--; break;
+            case opcode::lnot: for(size_t k = 0; k < n; k++) { b[k] = b[k] == 0; blo[k] = 0.0; } break;
+            case opcode::select:
+            {
+                double* c = r - 3 * slot_size;
+                for(size_t k = 0; k < n; k++)
+                {
+                    c[B + k] = select_bits(c[k], alo[k], blo[k]);
+                    c[k] = select_bits(c[k], a[k], b[k]);
+                }
+                sp -= 2;
+                break;
+            }
+            // Double-double needs no separate error term, the extra slot
+            // stays zero and the chain is a plain dd_add / dd_mul fold
+            case opcode::sum_begin:
+            case opcode::prod_begin: std::fill(r, r + 2 * B, 0.0); sp++; break;
+            case opcode::sum_add:
+            case opcode::prod_mul:
+            {
+                double* s = r - 3 * slot_size;
+                double* slo = s + B;
+                for(size_t k = 0; k < n; k++)
+                {
+                    double_double x(s[k], slo[k]), y(b[k], blo[k]);
+                    x = ins.op == opcode::sum_add ? dd_add(x, y) : dd_mul(x, y);
+                    s[k] = x.hi;
+                    slo[k] = x.lo;
+                }
+                sp--;
+                break;
+            }
+            case opcode::sum_end:
+            case opcode::prod_end: sp--; break;
+            }
+        }
+        for(size_t k = 0; k < n; k++)
+        {
+            out_hi[row + k] = regs[k];
+            out_lo[row + k] = regs[B + k];
+        }
+    }
+}
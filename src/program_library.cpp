@@ -0,0 +1,221 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "program_library.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#endif
+
+static const char LIBRARY_MAGIC[8] = { 'W', '3', '2', 'C', 'P', 'R', 'G', '\0' };
+
+struct library_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_count;
+    uint64_t index_offset;
+    uint64_t file_size;
+};
+
+struct library_index
+{
+    uint64_t name_hash;
+    uint64_t entry_offset;
+};
+
+struct library_entry
+{
+    uint64_t source_hash;
+    uint32_t code_size;
+    uint32_t constant_count;
+    uint32_t variable_count;
+    uint32_t max_stack;
+    uint32_t name_length;
+    uint32_t names_length;
+};
+
+static uint64_t align8(uint64_t n)
+{
+    return (n + 7) & ~(uint64_t)7;
+}
+
+// 64-bit throughout, counts read from a corrupt file must not wrap
+static uint64_t entry_size(const library_entry& e)
+{
+    return sizeof(library_entry) + 2 * (uint64_t)e.constant_count * sizeof(double) + (uint64_t)e.code_size * sizeof(instruction) +
+           align8((uint64_t)e.name_length + e.names_length);
+}
+
+// names_length bytes holding exactly variable_count NUL terminated names
+static bool valid_names(const char* names, uint32_t names_length, uint32_t variable_count)
+{
+    if(names_length > 0 && names[names_length - 1] != '\0')
+        return false;
+    uint64_t count = std::count(names, names + names_length, '\0');
+    return count == variable_count;
+}
+
+void program_library::write(const std::string& path, const std::vector<std::pair<std::string, program>>& programs)
+{
+    std::string blob(sizeof(library_header), '\0');
+    std::vector<library_index> index;
+    for(size_t i = 0; i < programs.size(); i++)
+    {
+        const std::string& name = programs[i].first;
+        program_view v = programs[i].second.view();
+        size_t names_length = 0;
+        for(uint32_t n = 0; n < v.variable_count; n++)
+            names_length += std::strlen(v.variable_names + names_length) + 1;
+
+        library_entry e;
+        e.source_hash = v.source_hash;
+        e.code_size = v.code_size;
+        e.constant_count = v.constant_count;
+        e.variable_count = v.variable_count;
+        e.max_stack = v.max_stack;
+        e.name_length = (uint32_t)name.size();
+        e.names_length = (uint32_t)names_length;
+
+        index.push_back({ hash_source(name), blob.size() });
+        blob.append((const char*)&e, sizeof(e));
+        blob.append((const char*)v.constants, v.constant_count * sizeof(double));
+        blob.append((const char*)v.constants_lo, v.constant_count * sizeof(double));
+        blob.append((const char*)v.code, v.code_size * sizeof(instruction));
+        blob.append(name);
+        blob.append(v.variable_names, names_length);
+        blob.resize((size_t)align8(blob.size()), '\0');
+    }
+
+    std::stable_sort(index.begin(), index.end(), [](const library_index& a, const library_index& b)
+    {
+        return a.name_hash < b.name_hash;
+    });
+
+    library_header h;
+    std::memcpy(h.magic, LIBRARY_MAGIC, sizeof(h.magic));
+    h.version = PROGRAM_LIBRARY_VERSION;
+    h.entry_count = (uint32_t)index.size();
+    h.index_offset = blob.size();
+    h.file_size = blob.size() + index.size() * sizeof(library_index);
+    std::memcpy(&blob[0], &h, sizeof(h));
+    blob.append((const char*)index.data(), index.size() * sizeof(library_index));
+
+    // Write to a temporary and rename, readers never see a half written file
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(blob.data(), blob.size());
+        if(!out)
+            throw std::runtime_error("Cannot write '" + tmp + "'");
+    }
+    // Replace in one step, there is never a moment without a library
+#if defined(_WIN32)
+    if(!MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+#else
+    if(std::rename(tmp.c_str(), path.c_str()) != 0)
+#endif
+        throw std::runtime_error("Cannot replace '" + path + "'");
+}
+
+program_library::program_library(const std::string& path) : file(path)
+{
+    if(file.size() < sizeof(library_header))
+        throw std::runtime_error("Not a program library: '" + path + "'");
+    const library_header* h = (const library_header*)file.data();
+    if(std::memcmp(h->magic, LIBRARY_MAGIC, sizeof(h->magic)) != 0)
+        throw std::runtime_error("Not a program library: '" + path + "'");
+    if(h->version != PROGRAM_LIBRARY_VERSION)
+        throw std::runtime_error("Unsupported program library version " + std::to_string(h->version));
+    if(h->file_size != file.size() || h->index_offset % 8 != 0 ||
+       h->index_offset + (uint64_t)h->entry_count * sizeof(library_index) != h->file_size)
+        throw std::runtime_error("Corrupt program library: '" + path + "'");
+}
+
+size_t program_library::size() const
+{
+    return ((const library_header*)file.data())->entry_count;
+}
+
+bool program_library::find(const std::string& name, program_view& out) const
+{
+    const library_header* h = (const library_header*)file.data();
+    const library_index* first = (const library_index*)(file.data() + h->index_offset);
+    const library_index* last = first + h->entry_count;
+    uint64_t key = hash_source(name);
+    const library_index* it = std::lower_bound(first, last, key, [](const library_index& r, uint64_t k)
+    {
+        return r.name_hash < k;
+    });
+
+    for(; it != last && it->name_hash == key; ++it)
+    {
+        if(it->entry_offset % 8 != 0 || h->index_offset < sizeof(library_entry) ||
+           it->entry_offset > h->index_offset - sizeof(library_entry))
+            throw std::runtime_error("Corrupt program library");
+        const unsigned char* p = file.data() + it->entry_offset;
+        const library_entry* e = (const library_entry*)p;
+        if(entry_size(*e) > h->index_offset - it->entry_offset)
+            throw std::runtime_error("Corrupt program library");
+
+        p += sizeof(library_entry);
+        const double* constants = (const double*)p;
+        p += e->constant_count * sizeof(double);
+        const double* constants_lo = (const double*)p;
+        p += e->constant_count * sizeof(double);
+        const instruction* code = (const instruction*)p;
+        p += e->code_size * sizeof(instruction);
+        const char* stored_name = (const char*)p;
+        if(e->name_length != name.size() || std::memcmp(stored_name, name.data(), name.size()) != 0)
+            continue;
+        if(!valid_names(stored_name + e->name_length, e->names_length, e->variable_count))
+            throw std::runtime_error("Corrupt program library");
+
+        out.code = code;
+        out.constants = constants;
+        out.constants_lo = constants_lo;
+        out.variable_names = stored_name + e->name_length;
+        out.code_size = e->code_size;
+        out.constant_count = e->constant_count;
+        out.variable_count = e->variable_count;
+        out.max_stack = e->max_stack;
+        out.source_hash = e->source_hash;
+        verify(out);
+        return true;
+    }
+    return false;
+}
+
+bool program_library::find(const std::string& name, const std::string& source, program_view& out) const
+{
+    program_view v;
+    if(!find(name, v) || v.source_hash != hash_source(source))
+        return false;
+    out = v;
+    return true;
+}
@@ -0,0 +1,354 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "rational.hpp"
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Combined numerator + denominator limbs before a big value gets reduced
+const size_t REDUCE_THRESHOLD = 8;
+
+static unsigned ctz64(uint64_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return index;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+static uint64_t gcd64(uint64_t a, uint64_t b)
+{
+    if(a == 0)
+        return b;
+    if(b == 0)
+        return a;
+    unsigned shift = ctz64(a | b);
+    a >>= ctz64(a);
+    do
+    {
+        b >>= ctz64(b);
+        if(a > b)
+            std::swap(a, b);
+        b -= a;
+    } while(b != 0);
+    return a << shift;
+}
+
+static bool checked_add(int64_t a, int64_t b, int64_t& out)
+{
+    if((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b))
+        return false;
+    out = a + b;
+    return true;
+}
+
+static bool checked_mul(int64_t a, int64_t b, int64_t& out)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_mul_overflow(a, b, &out);
+#else
+    uint64_t ua = a < 0 ? 0 - (uint64_t)a : (uint64_t)a;
+    uint64_t ub = b < 0 ? 0 - (uint64_t)b : (uint64_t)b;
+    if(ua != 0 && ub > UINT64_MAX / ua)
+        return false;
+    uint64_t p = ua * ub;
+    bool neg = (a < 0) != (b < 0);
+    if(neg ? p > (1ULL << 63) : p >= (1ULL << 63))
+        return false;
+    out = neg ? (int64_t)(0 - p) : (int64_t)p;
+    return true;
+#endif
+}
+
+static void reduce_words(int64_t& n, int64_t& d)
+{
+    uint64_t mag = n < 0 ? 0 - (uint64_t)n : (uint64_t)n;
+    uint64_t g = gcd64(mag, (uint64_t)d);
+    if(g > 1)
+    {
+        n /= (int64_t)g;
+        d /= (int64_t)g;
+    }
+}
+
+// n/d op rn/rd on machine words, leaves n and d untouched on overflow
+static bool apply_words(int64_t& n, int64_t& d, int64_t rn, int64_t rd, char op)
+{
+    int64_t a, b, c;
+    switch(op)
+    {
+    case '-':
+    case '+':
+    {
+        if(op == '-')
+        {
+            if(rn == INT64_MIN)
+                return false;
+            rn = -rn;
+        }
+        if(d == rd)
+        {
+            if(!checked_add(n, rn, a))
+                return false;
+            n = a;
+            return true;
+        }
+        if(!checked_mul(n, rd, a) || !checked_mul(rn, d, b) || !checked_add(a, b, a) || !checked_mul(d, rd, c))
+            return false;
+        n = a;
+        d = c;
+        return true;
+    }
+    case '*':
+    {
+        if(!checked_mul(n, rn, a) || !checked_mul(d, rd, b))
+            return false;
+        n = a;
+        d = b;
+        return true;
+    }
+    default:
+    {
+        if(!checked_mul(n, rd, a) || !checked_mul(d, rn, b))
+            return false;
+        if(b < 0)
+        {
+            if(a == INT64_MIN || b == INT64_MIN)
+                return false;
+            a = -a;
+            b = -b;
+        }
+        n = a;
+        d = b;
+        return true;
+    }
+    }
+}
+
+rational rational::from_literal(const std::string& text)
+{
+    std::string digits;
+    size_t frac = 0;
+    bool dec_pnt = false;
+    for(size_t i = 0; i < text.size(); i++)
+    {
+        if(text[i] == '.')
+        {
+            if(dec_pnt)
+                throw std::runtime_error("Invalid number format");
+            dec_pnt = true;
+            continue;
+        }
+        digits += text[i];
+        if(dec_pnt)
+            frac++;
+    }
+    if(digits.empty())
+        throw std::runtime_error("Invalid number format");
+
+    rational out;
+    if(digits.size() <= 18)
+    {
+        out.snum = std::stoll(digits);
+        for(size_t i = 0; i < frac; i++)
+            out.sden *= 10;
+        return out;
+    }
+    out.small = false;
+    out.num = big_int::from_string(digits);
+    out.den = big_int::from_string("1" + std::string(frac, '0'));
+    out.reduce_at = REDUCE_THRESHOLD;
+    return out;
+}
+
+rational rational::operator-() const
+{
+    rational out = *this;
+    if(out.small && out.snum == INT64_MIN)
+        out.promote();
+    if(out.small)
+        out.snum = -out.snum;
+    else
+        out.num = -out.num;
+    return out;
+}
+
+rational& rational::operator+=(const rational& rhs)
+{
+    apply(rhs, '+');
+    return *this;
+}
+
+rational& rational::operator-=(const rational& rhs)
+{
+    apply(rhs, '-');
+    return *this;
+}
+
+rational& rational::operator*=(const rational& rhs)
+{
+    apply(rhs, '*');
+    return *this;
+}
+
+rational& rational::operator/=(const rational& rhs)
+{
+    if(rhs.small ? rhs.snum == 0 : rhs.num.is_zero())
+        throw std::runtime_error("Division by zero");
+    apply(rhs, '/');
+    return *this;
+}
+
+void rational::apply(const rational& rhs, char op)
+{
+    if(small && rhs.small)
+    {
+        if(apply_words(snum, sden, rhs.snum, rhs.sden, op))
+            return;
+
+        // Overflowed, see whether the reduced operands still fit
+        int64_t n = snum, d = sden, rn = rhs.snum, rd = rhs.sden;
+        reduce_words(n, d);
+        reduce_words(rn, rd);
+        if(apply_words(n, d, rn, rd, op))
+        {
+            snum = n;
+            sden = d;
+            return;
+        }
+    }
+
+    promote();
+    rational big_rhs = rhs;
+    big_rhs.promote();
+    const big_int& rn = big_rhs.num;
+    const big_int& rd = big_rhs.den;
+    switch(op)
+    {
+    case '+':
+    case '-':
+    {
+        if(den == rd)
+        {
+            if(op == '+')
+                num += rn;
+            else
+                num -= rn;
+            break;
+        }
+        num *= rd;
+        if(op == '+')
+            num += rn * den;
+        else
+            num -= rn * den;
+        den *= rd;
+        break;
+    }
+    case '*':
+    {
+        num *= rn;
+        den *= rd;
+        break;
+    }
+    default:
+    {
+        num *= rd;
+        den *= rn;
+        if(den.is_negative())
+        {
+            num = -num;
+            den = -den;
+        }
+        break;
+    }
+    }
+
+    if(num.limb_count() + den.limb_count() > reduce_at)
+        reduce();
+}
+
+void rational::promote()
+{
+    if(!small)
+        return;
+    num = big_int(snum);
+    den = big_int(sden);
+    small = false;
+    reduce_at = REDUCE_THRESHOLD;
+}
+
+void rational::reduce()
+{
+    big_int g = big_int::gcd(num, den);
+    if(g != big_int(1))
+    {
+        num /= g;
+        den /= g;
+    }
+    // Values that stay large after reduction are not worth reducing again
+    // until they have grown noticeably
+    reduce_at = std::max(REDUCE_THRESHOLD, 2 * (num.limb_count() + den.limb_count()));
+}
+
+void rational::normalize()
+{
+    if(small)
+    {
+        reduce_words(snum, sden);
+        return;
+    }
+    reduce();
+    if(num.fits_int64() && den.fits_int64())
+    {
+        snum = num.to_int64();
+        sden = den.to_int64();
+        num = big_int();
+        den = big_int();
+        small = true;
+    }
+}
+
+int rational::compare(const rational& a, const rational& b)
+{
+    // Denominators are positive, so the difference has the sign we want
+    rational d = a;
+    d -= b;
+    return d.is_negative() ? -1 : d.is_zero() ? 0 : 1;
+}
+
+std::string rational::to_string() const
+{
+    if(small)
+        return sden == 1 ? std::to_string(snum) : std::to_string(snum) + "/" + std::to_string(sden);
+    if(den == big_int(1))
+        return num.to_string();
+    return num.to_string() + "/" + den.to_string();
+}
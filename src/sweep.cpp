@@ -0,0 +1,179 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "sweep.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ostream>
+
+// Longest "%.15g" output plus a separator
+const size_t FIELD_WIDTH = 32;
+
+static const double POW10[16] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+};
+
+// Same text as "%.15g", without going through printf for the common case
+// of values with few decimals. If v * 10^k rounds to an integer N below
+// 10^15, v is within one rounding of N / 10^k, far closer than half a unit
+// in the 15th digit, so N holds exactly the digits printf would print.
+static char* format_number(char* cur, double v)
+{
+    double a = std::fabs(v);
+    if(a == 0 || (a >= 1e-4 && a < 1e15))
+    {
+        for(int k = 0; k < 16; k++)
+        {
+            double t = a * POW10[k];
+            if(t >= 1e15)
+                break;
+            if(t != std::floor(t))
+                continue;
+
+            char digits[24];
+            int n = 0;
+            uint64_t q = (uint64_t)t;
+            // A smaller k can miss by one rounding, drop the extra zeros
+            while(k > 0 && q % 10 == 0)
+            {
+                q /= 10;
+                k--;
+            }
+            for(; q != 0 || n <= k; q /= 10)
+                digits[n++] = (char)('0' + q % 10);
+            if(std::signbit(v))
+                *cur++ = '-';
+            while(n > k)
+                *cur++ = digits[--n];
+            if(k > 0)
+            {
+                *cur++ = '.';
+                while(n > 0)
+                    *cur++ = digits[--n];
+            }
+            return cur;
+        }
+    }
+    return cur + std::snprintf(cur, FIELD_WIDTH, "%.15g", v);
+}
+
+uint64_t sweep_points(const sweep_range& range)
+{
+    if(!std::isfinite(range.start) || !std::isfinite(range.stop) || !std::isfinite(range.step) || range.step == 0)
+        throw std::runtime_error("Invalid range for '" + range.variable + "'");
+    double span = (range.stop - range.start) / range.step;
+    if(span < 0)
+        throw std::runtime_error("Range for '" + range.variable + "' steps away from its end");
+    // Tolerate rounding in span so an exact endpoint is not lost. The
+    // slack is absolute, a relative one adds whole points past stop once
+    // span reaches about 1e12.
+    double count = std::floor(span + 1e-9) + 1;
+    if(count >= 9.2e18)
+        throw std::runtime_error("Range for '" + range.variable + "' is too long");
+    return (uint64_t)count;
+}
+
+uint64_t sweep(const program_view& p, const std::vector<sweep_range>& ranges, const sweep_sink& sink)
+{
+    std::vector<uint64_t> counts(ranges.size());
+    uint64_t total = 1;
+    for(size_t r = 0; r < ranges.size(); r++)
+    {
+        counts[r] = sweep_points(ranges[r]);
+        if(counts[r] != 0 && total > UINT64_MAX / counts[r])
+            throw std::runtime_error("Sweep grid is too large");
+        total *= counts[r];
+    }
+
+    std::vector<std::vector<double>> values(ranges.size(), std::vector<double>(SWEEP_BLOCK));
+    std::vector<const double*> range_columns(ranges.size());
+    for(size_t r = 0; r < ranges.size(); r++)
+        range_columns[r] = values[r].data();
+
+    // Program slots read the column of the range with the same name
+    std::vector<const double*> slot_columns(p.variable_count);
+    const char* name = p.variable_names;
+    for(uint32_t slot = 0; slot < p.variable_count; slot++, name += std::char_traits<char>::length(name) + 1)
+    {
+        size_t r = 0;
+        while(r < ranges.size() && ranges[r].variable != name)
+            r++;
+        if(r == ranges.size())
+            throw std::runtime_error("No range for variable '" + std::string(name) + "'");
+        slot_columns[slot] = range_columns[r];
+    }
+
+    std::vector<double> results(SWEEP_BLOCK);
+    std::vector<uint64_t> at(ranges.size(), 0); // Grid position of the next row
+    for(uint64_t row = 0; row < total; row += SWEEP_BLOCK)
+    {
+        size_t n = (size_t)std::min<uint64_t>(SWEEP_BLOCK, total - row);
+        for(size_t k = 0; k < n; k++)
+        {
+            for(size_t r = 0; r < ranges.size(); r++)
+                values[r][k] = ranges[r].start + (double)at[r] * ranges[r].step;
+            for(size_t r = ranges.size(); r-- > 0;)
+            {
+                if(++at[r] < counts[r])
+                    break;
+                at[r] = 0;
+            }
+        }
+        run_batch(p, slot_columns.data(), results.data(), n);
+        sweep_block block = { range_columns.data(), ranges.size(), results.data(), n, row };
+        sink(block);
+    }
+    return total;
+}
+
+table_writer::table_writer(std::ostream& out, const std::vector<sweep_range>& ranges, char separator) :
+    out(out), separator(separator)
+{
+    for(size_t r = 0; r < ranges.size(); r++)
+        header += ranges[r].variable + separator;
+    header += "result\n";
+}
+
+void table_writer::operator()(const sweep_block& block)
+{
+    // Header goes out with the first block, a sweep that fails to start
+    // writes nothing
+    if(block.first_row == 0)
+        out << header;
+    buffer.resize(block.rows * (block.column_count + 1) * FIELD_WIDTH);
+    char* cur = buffer.data();
+    for(size_t k = 0; k < block.rows; k++)
+    {
+        for(size_t c = 0; c < block.column_count; c++)
+        {
+            cur = format_number(cur, block.columns[c][k]);
+            *cur++ = separator;
+        }
+        cur = format_number(cur, block.results[k]);
+        *cur++ = '\n';
+    }
+    out.write(buffer.data(), cur - buffer.data());
+}
@@ -0,0 +1,100 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "tiered_eval.hpp"
+
+tiered_evaluator::tiered_evaluator(uint32_t promote_after, size_t capacity) :
+    promote_after(promote_after), capacity(capacity), compiled(0)
+{
+}
+
+double tiered_evaluator::evaluate(const std::string& infix, tier_stats* stats)
+{
+    auto it = entries.find(infix);
+    if(it == entries.end())
+    {
+        if(entries.size() >= capacity)
+            evict();
+        // Only expressions that evaluate are tracked
+        double value = evaluate_direct(infix);
+        it = entries.insert(std::make_pair(infix, entry())).first;
+        it->second.calls = 1;
+        if(stats != nullptr)
+            *stats = { 1, false };
+        return value;
+    }
+
+    entry& e = it->second;
+    e.calls++;
+    if(!e.prog && e.calls > promote_after)
+    {
+        // Unflattened, so promotion never changes a result
+        e.prog.reset(new program(program::compile(infix, false)));
+        e.view = e.prog->view();
+        compiled++;
+    }
+    if(stats != nullptr)
+        *stats = { e.calls, (bool)e.prog };
+    return e.prog ? run(e.view, nullptr) : evaluate_direct(infix);
+}
+
+tier_stats tiered_evaluator::stats(const std::string& infix) const
+{
+    auto it = entries.find(infix);
+    if(it == entries.end())
+        return { 0, false };
+    return { it->second.calls, (bool)it->second.prog };
+}
+
+// Age the counters of expressions still running directly, halving them
+// until some reach zero and are forgotten, so an expression that is close
+// to promotion survives a burst of one-off inputs. If everything tracked
+// is compiled, start over
+void tiered_evaluator::evict()
+{
+    bool uncompiled = true;
+    while(entries.size() >= capacity && uncompiled)
+    {
+        uncompiled = false;
+        for(auto it = entries.begin(); it != entries.end();)
+        {
+            if(it->second.prog)
+            {
+                ++it;
+                continue;
+            }
+            uncompiled = true;
+            it->second.calls /= 2;
+            if(it->second.calls == 0)
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+    }
+    if(entries.size() >= capacity)
+    {
+        entries.clear();
+        compiled = 0;
+    }
+}
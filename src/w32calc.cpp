@@ -0,0 +1,269 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "w32calc.h"
+#include "batch_f32.hpp"
+#include "batch_interval.hpp"
+#include "gradient.hpp"
+#include <cstring>
+#include <new>
+
+struct w32calc_program
+{
+    program prog;
+    program_view view;
+};
+
+static thread_local std::string last_error;
+
+static w32calc_status fail(w32calc_status status, const char* message)
+{
+    last_error = message;
+    return status;
+}
+
+// Runs fn, turning exceptions into status codes at the ABI boundary
+template<typename F>
+static w32calc_status guarded(F fn)
+{
+    try
+    {
+        return fn();
+    }
+    catch(const std::bad_alloc&)
+    {
+        return fail(W32CALC_ERROR_MEMORY, "Out of memory");
+    }
+    catch(const std::exception& e)
+    {
+        return fail(W32CALC_ERROR_EXPRESSION, e.what());
+    }
+    catch(...)
+    {
+        return fail(W32CALC_ERROR_EXPRESSION, "Unknown error");
+    }
+}
+
+template<typename T>
+static w32calc_status check_batch(const w32calc_program* program, const T* const* columns, size_t column_count, size_t rows)
+{
+    if(program == nullptr || column_count != program->view.variable_count)
+        return fail(W32CALC_ERROR_ARGUMENT, "Column count does not match the program's variables");
+    if(rows == 0)
+        return W32CALC_OK;
+    if(column_count > 0 && columns == nullptr)
+        return fail(W32CALC_ERROR_ARGUMENT, "Null column array");
+    for(size_t i = 0; i < column_count; i++)
+    {
+        if(columns[i] == nullptr)
+            return fail(W32CALC_ERROR_ARGUMENT, "Null column");
+    }
+    return W32CALC_OK;
+}
+
+int w32calc_abi_version(void)
+{
+    return W32CALC_ABI_VERSION;
+}
+
+const char* w32calc_last_error(void)
+{
+    return last_error.c_str();
+}
+
+w32calc_status w32calc_evaluate(const char* expr, size_t expr_len, w32calc_mode mode,
+                                char* out, size_t out_size, size_t* out_len)
+{
+    if((expr == nullptr && expr_len > 0) || (out == nullptr && out_size > 0))
+        return fail(W32CALC_ERROR_ARGUMENT, "Null buffer");
+    if(mode < W32CALC_MODE_FLOATING || mode > W32CALC_MODE_DOUBLE_DOUBLE)
+        return fail(W32CALC_ERROR_ARGUMENT, "Unknown mode");
+    return guarded([&]()
+    {
+        // Floating mode parses and evaluates in one pass, no token buffer
+        std::string source(expr, expr_len);
+        std::string result = mode == W32CALC_MODE_FLOATING ? format_result(evaluate_direct(source)) : evaluate(source, (eval_mode)mode);
+        if(out_len != nullptr)
+            *out_len = result.size();
+        if(result.size() >= out_size)
+            return fail(W32CALC_ERROR_BUFFER, "Output buffer too small");
+        std::memcpy(out, result.c_str(), result.size() + 1);
+        return W32CALC_OK;
+    });
+}
+
+w32calc_status w32calc_evaluate_double(const char* expr, size_t expr_len, double* out)
+{
+    if((expr == nullptr && expr_len > 0) || out == nullptr)
+        return fail(W32CALC_ERROR_ARGUMENT, "Null buffer");
+    return guarded([&]()
+    {
+        *out = evaluate_direct(std::string(expr, expr_len));
+        return W32CALC_OK;
+    });
+}
+
+w32calc_status w32calc_compile(const char* expr, size_t expr_len, w32calc_program** out)
+{
+    if((expr == nullptr && expr_len > 0) || out == nullptr)
+        return fail(W32CALC_ERROR_ARGUMENT, "Null buffer");
+    *out = nullptr;
+    return guarded([&]()
+    {
+        w32calc_program* p = new w32calc_program{ program::compile(std::string(expr, expr_len)), program_view() };
+        p->view = p->prog.view();
+        *out = p;
+        return W32CALC_OK;
+    });
+}
+
+void w32calc_program_free(w32calc_program* program)
+{
+    delete program;
+}
+
+uint32_t w32calc_program_variable_count(const w32calc_program* program)
+{
+    return program == nullptr ? 0 : program->view.variable_count;
+}
+
+w32calc_status w32calc_program_variable_name(const w32calc_program* program, uint32_t slot, const char** name)
+{
+    if(program == nullptr || name == nullptr || slot >= program->view.variable_count)
+        return fail(W32CALC_ERROR_ARGUMENT, "Variable slot out of range");
+    *name = program->prog.variables()[slot].c_str();
+    return W32CALC_OK;
+}
+
+w32calc_status w32calc_program_find_variable(const w32calc_program* program, const char* name, size_t name_len, uint32_t* slot)
+{
+    if(program == nullptr || (name == nullptr && name_len > 0) || slot == nullptr)
+        return fail(W32CALC_ERROR_ARGUMENT, "Null argument");
+    return guarded([&]()
+    {
+        if(!find_variable(program->view, std::string(name, name_len), *slot))
+            return fail(W32CALC_ERROR_ARGUMENT, "Unknown variable");
+        return W32CALC_OK;
+    });
+}
+
+w32calc_status w32calc_run(const w32calc_program* program, const double* variables, size_t variable_count, double* out)
+{
+    if(program == nullptr || out == nullptr || variable_count != program->view.variable_count ||
+       (variables == nullptr && variable_count > 0))
+        return fail(W32CALC_ERROR_ARGUMENT, "Variable count does not match the program");
+    return guarded([&]()
+    {
+        *out = run(program->view, variables);
+        return W32CALC_OK;
+    });
+}
+
+w32calc_status w32calc_run_batch(const w32calc_program* program, const double* const* columns, size_t column_count,
+                                 double* out, size_t rows)
+{
+    w32calc_status status = check_batch(program, columns, column_count, rows);
+    if(status != W32CALC_OK || rows == 0)
+        return status;
+    if(out == nullptr)
+        return fail(W32CALC_ERROR_ARGUMENT, "Null output");
+    return guarded([&]()
+    {
+        run_batch(program->view, columns, out, rows);
+        return W32CALC_OK;
+    });
+}
+
+w32calc_status w32calc_run_batch_dd(const w32calc_program* program, const double* const* columns, size_t column_count,
+                                    double* out_hi, double* out_lo, size_t rows)
+{
+    w32calc_status status = check_batch(program, columns, column_count, rows);
+    if(status != W32CALC_OK || rows == 0)
+        return status;
+    if(out_hi == nullptr || out_lo == nullptr)
+        return fail(W32CALC_ERROR_ARGUMENT, "Null output");
+    return guarded([&]()
+    {
+        run_batch_dd(program->view, columns, out_hi, out_lo, rows);
+        return W32CALC_OK;
+    });
+}
+
+w32calc_status w32calc_run_batch_f32(const w32calc_program* program, const float* const* columns, size_t column_count,
+                                     float* out, size_t rows, float tolerance, size_t* recomputed)
+{
+    if(recomputed != nullptr)
+        *recomputed = 0;
+    w32calc_status status = check_batch(program, columns, column_count, rows);
+    if(status != W32CALC_OK || rows == 0)
+        return status;
+    if(out == nullptr)
+        return fail(W32CALC_ERROR_ARGUMENT, "Null output");
+    return guarded([&]()
+    {
+        size_t count = run_batch_f32(program->view, columns, out, rows, tolerance);
+        if(recomputed != nullptr)
+            *recomputed = count;
+        return W32CALC_OK;
+    });
+}
+
+w32calc_status w32calc_run_batch_interval(const w32calc_program* program, const double* const* lo_columns,
+                                          const double* const* hi_columns, size_t column_count,
+                                          double* out_lo, double* out_hi, size_t rows)
+{
+    w32calc_status status = check_batch(program, lo_columns, column_count, rows);
+    if(status == W32CALC_OK)
+        status = check_batch(program, hi_columns, column_count, rows);
+    if(status != W32CALC_OK || rows == 0)
+        return status;
+    if(out_lo == nullptr || out_hi == nullptr)
+        return fail(W32CALC_ERROR_ARGUMENT, "Null output");
+    return guarded([&]()
+    {
+        run_batch_interval(program->view, lo_columns, hi_columns, out_lo, out_hi, rows);
+        return W32CALC_OK;
+    });
+}
+
+w32calc_status w32calc_run_batch_gradient(const w32calc_program* program, const double* const* columns, size_t column_count,
+                                          const uint32_t* wrt, size_t wrt_count,
+                                          double* values, double* const* gradients, size_t rows)
+{
+    w32calc_status status = check_batch(program, columns, column_count, rows);
+    if(status != W32CALC_OK || rows == 0)
+        return status;
+    if(values == nullptr || (wrt_count > 0 && (wrt == nullptr || gradients == nullptr)))
+        return fail(W32CALC_ERROR_ARGUMENT, "Null output");
+    for(size_t j = 0; j < wrt_count; j++)
+    {
+        if(wrt[j] >= program->view.variable_count || gradients[j] == nullptr)
+            return fail(W32CALC_ERROR_ARGUMENT, "Bad gradient slot or output");
+    }
+    return guarded([&]()
+    {
+        run_batch_gradient(program->view, columns, wrt, wrt_count, values, gradients, rows);
+        return W32CALC_OK;
+    });
+}
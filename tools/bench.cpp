@@ -0,0 +1,215 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Micro benchmarks for the exact arithmetic.
+//
+//   w32calc_bench mul [max digits]
+//   w32calc_bench dd [rows]
+//
+// mul: products of two n-digit literals in integer mode, n doubling from
+// 100. Times the multiply alone and the whole evaluate() call (parse,
+// multiply, format). Per doubling, schoolbook grows about 4x, Karatsuba
+// about 3x and Toom-3 about 2.7x.
+//
+// dd: rows per second of one formula in double, double-double and, where
+// the compiler has it, __float128. Each type runs a hand-written loop;
+// double and double-double also run through run_batch / run_batch_dd.
+
+#include "program.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+typedef std::chrono::steady_clock bench_clock;
+
+// Runs fn until at least 0.2 s have passed, returns seconds per run
+template<typename F>
+static double time_per_run(F fn)
+{
+    size_t runs = 0;
+    auto start = bench_clock::now();
+    double elapsed;
+    do
+    {
+        fn();
+        runs++;
+        elapsed = std::chrono::duration<double>(bench_clock::now() - start).count();
+    } while(elapsed < 0.2);
+    return elapsed / runs;
+}
+
+// Deterministic digits, no leading zero
+static std::string digits(size_t n, uint32_t seed)
+{
+    std::string out(n, '0');
+    for(size_t i = 0; i < n; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        out[i] = (char)('0' + (seed >> 24) % 10);
+    }
+    if(out[0] == '0')
+        out[0] = '1';
+    return out;
+}
+
+static void bench_mul(size_t max_digits)
+{
+    std::printf("%9s %7s %14s %8s %14s\n", "digits", "limbs", "multiply us", "growth", "evaluate ms");
+    double previous = 0;
+    for(size_t n = 100; n <= max_digits; n *= 2)
+    {
+        std::string a = digits(n, 1), b = digits(n, 2);
+        big_int x = big_int::from_string(a), y = big_int::from_string(b);
+        size_t limbs = 0;
+        double multiply = time_per_run([&]()
+        {
+            limbs = (x * y).limb_count();
+        });
+        std::string expr = a + "*" + b;
+        size_t length = 0;
+        double whole = time_per_run([&]()
+        {
+            length = evaluate(expr, eval_mode::integer).size();
+        });
+        if(length < 2 * n - 1)
+            std::printf("unexpected result length %zu\n", length);
+        if(previous > 0)
+            std::printf("%9zu %7zu %14.2f %7.2fx %14.3f\n", n, x.limb_count(), multiply * 1e6, multiply / previous, whole * 1e3);
+        else
+            std::printf("%9zu %7zu %14.2f %8s %14.3f\n", n, x.limb_count(), multiply * 1e6, "", whole * 1e3);
+        previous = multiply;
+    }
+}
+
+// The formula of the dd benchmark, x*y + x/(y+3) - 0.1*x, in each type
+static const char* DD_FORMULA = "x*y + x/(y+3) - 0.1*x";
+
+static double formula(double x, double y)
+{
+    return x * y + x / (y + 3) - 0.1 * x;
+}
+
+static double_double formula(const double_double& x, const double_double& y, const double_double& tenth)
+{
+    return dd_add(dd_add(dd_mul(x, y), dd_div(x, dd_add(y, double_double(3.0)))), -dd_mul(tenth, x));
+}
+
+#if defined(__SIZEOF_FLOAT128__)
+static __float128 formula(__float128 x, __float128 y, __float128 tenth)
+{
+    return x * y + x / (y + 3) - tenth * x;
+}
+#endif
+
+static void report_rows(const char* name, double seconds, size_t rows, double baseline, double check)
+{
+    double ns = seconds * 1e9 / rows;
+    std::printf("%-22s %10.2f %10.1f %9.2fx %24.17g\n", name, ns, rows / seconds / 1e6, baseline > 0 ? ns / baseline : 1.0, check);
+}
+
+static void bench_dd(size_t rows)
+{
+    std::vector<double> x(rows), y(rows), out(rows), out_lo(rows);
+    uint32_t seed = 7;
+    for(size_t i = 0; i < rows; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        x[i] = 0.5 + (seed >> 8) * (1.0 / (1 << 24));
+        seed = seed * 1664525u + 1013904223u;
+        y[i] = 0.5 + (seed >> 8) * (1.0 / (1 << 24));
+    }
+    program p = program::compile(DD_FORMULA);
+    program_view v = p.view();
+    const double* columns[2];
+    uint32_t slot;
+    find_variable(v, "x", slot);
+    columns[slot] = x.data();
+    find_variable(v, "y", slot);
+    columns[slot] = y.data();
+
+    std::printf("%s, %zu rows\n", DD_FORMULA, rows);
+    std::printf("%-22s %10s %10s %10s %24s\n", "", "ns/row", "Mrows/s", "vs double", "row 0");
+    double t = time_per_run([&]()
+    {
+        for(size_t i = 0; i < rows; i++)
+            out[i] = formula(x[i], y[i]);
+    });
+    double baseline = t * 1e9 / rows;
+    report_rows("double loop", t, rows, baseline, out[0]);
+    t = time_per_run([&]() { run_batch(v, columns, out.data(), rows); });
+    report_rows("run_batch", t, rows, baseline, out[0]);
+
+    double_double tenth = double_double::from_literal("0.1");
+    t = time_per_run([&]()
+    {
+        for(size_t i = 0; i < rows; i++)
+        {
+            double_double r = formula(double_double(x[i]), double_double(y[i]), tenth);
+            out[i] = r.hi;
+            out_lo[i] = r.lo;
+        }
+    });
+    report_rows("double-double loop", t, rows, baseline, out[0]);
+    t = time_per_run([&]() { run_batch_dd(v, columns, out.data(), out_lo.data(), rows); });
+    report_rows("run_batch_dd", t, rows, baseline, out[0]);
+
+#if defined(__SIZEOF_FLOAT128__)
+    __float128 tenth_q = (__float128)1 / 10;
+    std::vector<__float128> out_q(rows);
+    t = time_per_run([&]()
+    {
+        for(size_t i = 0; i < rows; i++)
+            out_q[i] = formula((__float128)x[i], (__float128)y[i], tenth_q);
+    });
+    report_rows("__float128 loop", t, rows, baseline, (double)out_q[0]);
+#else
+    std::printf("__float128 not available with this compiler\n");
+#endif
+}
+
+int main(int argc, char** argv)
+{
+    bool mul = argc >= 2 && std::strcmp(argv[1], "mul") == 0;
+    bool dd = argc >= 2 && std::strcmp(argv[1], "dd") == 0;
+    if(!mul && !dd)
+    {
+        std::fprintf(stderr, "usage: %s mul [max digits]\n       %s dd [rows]\n", argv[0], argv[0]);
+        return 2;
+    }
+    try
+    {
+        long n = argc > 2 ? std::strtol(argv[2], nullptr, 10) : 0;
+        if(mul)
+            bench_mul(n <= 0 ? 204800 : (n < 100 ? 100 : (size_t)n));
+        else
+            bench_dd(n <= 0 ? 1 << 16 : (size_t)n);
+    }
+    catch(std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,174 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Replays a recorded calculator session headlessly and reports how long
+// each event took through the editing and evaluation path, and how many
+// heap allocations it made.
+//
+//   w32calc_replay <session file> [repeat]
+//
+// Record a session by starting W32Calc with W32CALC_RECORD=<file>.
+
+#include "calc_input.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+struct sample
+{
+    double micros;
+    size_t allocs;
+};
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const std::vector<sample>& sorted, double p)
+{
+    size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.5);
+    rank = std::min(std::max(rank, (size_t)1), sorted.size());
+    return sorted[rank - 1].micros;
+}
+
+static void report(const char* name, std::vector<sample> samples)
+{
+    if(samples.empty())
+    {
+        std::printf("%-9s %8u\n", name, 0u);
+        return;
+    }
+    std::sort(samples.begin(), samples.end(), [](const sample& a, const sample& b) { return a.micros < b.micros; });
+    size_t total = 0, most = 0;
+    for(size_t i = 0; i < samples.size(); i++)
+    {
+        total += samples[i].allocs;
+        most = std::max(most, samples[i].allocs);
+    }
+    std::printf("%-9s %8zu %9.2f %9.2f %9.2f %9.2f %9.2f %11.2f %10zu\n", name, samples.size(),
+                percentile(samples, 50), percentile(samples, 90), percentile(samples, 99),
+                percentile(samples, 99.9), samples.back().micros,
+                (double)total / samples.size(), most);
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        std::fprintf(stderr, "usage: %s <session file> [repeat]\n", argv[0]);
+        return 2;
+    }
+    long repeat = argc > 2 ? std::strtol(argv[2], nullptr, 10) : 1;
+    if(repeat < 1)
+        repeat = 1;
+
+    std::vector<input_event> events;
+    try
+    {
+        std::ifstream in(argv[1]);
+        if(!in)
+        {
+            std::fprintf(stderr, "cannot open %s\n", argv[1]);
+            return 1;
+        }
+        events = read_session(in);
+    }
+    catch(std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    std::vector<sample> edit, eval;
+    edit.reserve(events.size() * repeat);
+    eval.reserve(events.size() * repeat);
+    size_t errors = 0;
+    std::wstring display, final_text;
+    size_t promoted = 0;
+    display.reserve(4096);
+    std::string error;
+    for(long r = 0; r < repeat; r++)
+    {
+        calc_input core;
+        for(size_t i = 0; i < events.size(); i++)
+        {
+            // One event is what WndProc does for it: the input handler, then
+            // the display refresh on the next message
+            size_t before = allocations.load(std::memory_order_relaxed);
+            auto start = std::chrono::steady_clock::now();
+            core.handle(events[i]);
+            core.refresh(display);
+            auto stop = std::chrono::steady_clock::now();
+            sample s = { std::chrono::duration<double, std::micro>(stop - start).count(),
+                         allocations.load(std::memory_order_relaxed) - before };
+            (evaluates(events[i]) ? eval : edit).push_back(s);
+            if(core.take_error(error))
+                errors++;
+        }
+        final_text = core.text();
+        promoted = core.evaluations().compiled_count();
+    }
+
+    std::printf("%zu events x %ld, %zu errors, %zu expressions compiled, final input \"%s\"\n", events.size(), repeat,
+                errors, promoted, std::string(final_text.begin(), final_text.end()).c_str());
+    std::printf("%-9s %8s %9s %9s %9s %9s %9s %11s %10s\n", "us/event", "count", "p50", "p90", "p99", "p99.9", "max", "allocs/evt", "max allocs");
+    std::vector<sample> all(edit);
+    all.insert(all.end(), eval.begin(), eval.end());
+    report("edit", edit);
+    report("evaluate", eval);
+    report("all", all);
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*
+MIT License
+
+Copyright (c) 2023 Duy Pham Duc
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Tabulates one expression over a grid of variable ranges and streams the
+// table to stdout.
+//
+//   w32calc_sweep [--tsv] <expression> <name>=<start>:<stop>:<step> ...
+//
+// The last range varies fastest.
+
+#include "sweep.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static bool parse_range(const char* arg, sweep_range& out)
+{
+    const char* eq = std::strchr(arg, '=');
+    if(eq == nullptr || eq == arg)
+        return false;
+    out.variable.assign(arg, eq - arg);
+    char* end;
+    out.start = std::strtod(eq + 1, &end);
+    if(*end != ':')
+        return false;
+    out.stop = std::strtod(end + 1, &end);
+    if(*end != ':')
+        return false;
+    out.step = std::strtod(end + 1, &end);
+    return *end == '\0';
+}
+
+int main(int argc, char** argv)
+{
+    int arg = 1;
+    char separator = ',';
+    if(arg < argc && std::strcmp(argv[arg], "--tsv") == 0)
+    {
+        separator = '\t';
+        arg++;
+    }
+    if(arg >= argc)
+    {
+        std::fprintf(stderr, "usage: %s [--tsv] <expression> <name>=<start>:<stop>:<step> ...\n", argv[0]);
+        return 2;
+    }
+
+    const char* expression = argv[arg++];
+    std::vector<sweep_range> ranges;
+    for(; arg < argc; arg++)
+    {
+        sweep_range r;
+        if(!parse_range(argv[arg], r))
+        {
+            std::fprintf(stderr, "bad range '%s', expected name=start:stop:step\n", argv[arg]);
+            return 2;
+        }
+        ranges.push_back(r);
+    }
+
+    try
+    {
+        std::ios::sync_with_stdio(false);
+        program prog = program::compile(expression);
+        table_writer writer(std::cout, ranges, separator);
+        sweep(prog.view(), ranges, std::ref(writer));
+        std::cout.flush();
+    }
+    catch(std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}